@@ -1,11 +1,23 @@
 #version 420
 
-//layout(binding=0) uniform matrices {
-//    mat4 transformNormal;
-//    mat4 transformWithProjection;
-//};
-uniform mat4 transformNormal;
-uniform mat4 transformWithProjection;
+struct Light {
+    vec3 direction;
+    vec3 ambientColor;
+    vec3 diffuseColor;
+    vec3 specularColor;
+};
+
+layout(std140, binding = 0) uniform Frame {
+    mat4 viewProjection;
+    vec3 view;
+    float time;
+    Light light;
+};
+
+layout(std140, binding = 1) uniform Object {
+    mat4 transform;
+    mat4 transformNormal;
+};
 
 in vec3 position;
 in vec3 normal;
@@ -17,5 +29,5 @@ out vec2 fragTexCoords;
 void main(void) {
     fragNormal = mat3(transformNormal) * normal;
     fragTexCoords = texCoords;
-    gl_Position = transformWithProjection * vec4(position, 1);
+    gl_Position = viewProjection * transform * vec4(position, 1);
 }
@@ -7,18 +7,22 @@ struct Light {
     vec3 specularColor;
 };
 
+layout(std140, binding = 0) uniform Frame {
+    mat4 viewProjection;
+    vec3 view;
+    float time;
+    Light light;
+};
+
 struct Material {
     vec3 ambientColor;
     vec3 diffuseColor;
     vec3 specularColor;
 };
 
-uniform float time;
 uniform sampler2D sampler_;
-uniform Light light;
 uniform Material material;
 uniform float shininess;
-uniform vec3 view;
 
 in vec3 fragNormal;
 in vec2 fragTexCoords;
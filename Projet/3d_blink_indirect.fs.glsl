@@ -0,0 +1,82 @@
+#version 430
+#extension GL_ARB_bindless_texture : enable
+
+struct Light {
+    vec3 direction;
+    vec3 ambientColor;
+    vec3 diffuseColor;
+    vec3 specularColor;
+};
+
+layout(std140, binding = 0) uniform Frame {
+    mat4 viewProjection;
+    vec3 view;
+    float time;
+    Light light;
+};
+
+struct DrawData {
+    mat4 transform;
+    mat4 transformNormal;
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    // w: shininess
+    vec4 specularColor;
+    // Layer in textureArray, or index in textureHandles
+    uint textureIndex;
+};
+
+layout(std430, binding = 2) readonly buffer Draws {
+    DrawData draws[];
+};
+
+// Where the texture of a draw comes from: 0 sampler_, bound per batch; 1 a layer of textureArray; 2 a bindless handle
+uniform int textureSource;
+uniform sampler2D sampler_;
+uniform sampler2DArray textureArray;
+
+#ifdef GL_ARB_bindless_texture
+layout(std430, binding = 8) readonly buffer TextureHandles {
+    uvec2 textureHandles[];
+};
+#endif
+
+in vec3 fragNormal;
+in vec2 fragTexCoords;
+flat in uint fragDrawId;
+
+out vec4 color;
+
+// Draws of one multi-draw call are separate invocation groups, so the handle is dynamically uniform
+vec4 diffuseTexel(vec2 coords) {
+    uint index = draws[fragDrawId].textureIndex;
+#ifdef GL_ARB_bindless_texture
+    if (textureSource == 2)
+        return texture(sampler2D(textureHandles[index]), coords);
+#endif
+    if (textureSource == 1)
+        return texture(textureArray, vec3(coords, float(index)));
+    return texture(sampler_, coords);
+}
+
+vec3 ambient() {
+    return light.ambientColor * draws[fragDrawId].ambientColor.rgb;
+}
+
+vec3 diffuse(vec3 n, vec3 l) {
+    return max(0.0, dot(n, l)) * light.diffuseColor * draws[fragDrawId].diffuseColor.rgb;
+}
+
+vec3 specular(vec3 n, vec3 l) {
+    if (dot(n, l) <= 0)
+        return vec3(0);
+    vec3 h = normalize(l + view);
+    return max(0.0, pow(dot(n, h), draws[fragDrawId].specularColor.w)) * light.specularColor * draws[fragDrawId].specularColor.rgb;
+}
+
+void main(void) {
+    vec3 n = normalize(fragNormal);
+    vec3 l = -light.direction;
+    float blink = 0.5 + 0.5 * sin(time * 7);
+    color = diffuseTexel(vec2(fragTexCoords.x, -fragTexCoords.y)) * vec4(ambient() + diffuse(n, l) + specular(n, l), 0) * vec4(blink, blink, blink, 1);
+}
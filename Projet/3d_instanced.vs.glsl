@@ -0,0 +1,30 @@
+#version 420
+
+struct Light {
+    vec3 direction;
+    vec3 ambientColor;
+    vec3 diffuseColor;
+    vec3 specularColor;
+};
+
+layout(std140, binding = 0) uniform Frame {
+    mat4 viewProjection;
+    vec3 view;
+    float time;
+    Light light;
+};
+
+in mat4 instanceTransform;
+in mat4 instanceTransformNormal;
+in vec3 position;
+in vec3 normal;
+in vec2 texCoords;
+
+out vec3 fragNormal;
+out vec2 fragTexCoords;
+
+void main(void) {
+    fragNormal = mat3(instanceTransformNormal) * normal;
+    fragTexCoords = texCoords;
+    gl_Position = viewProjection * instanceTransform * vec4(position, 1);
+}
@@ -1,12 +1,23 @@
 #version 420
 
-uniform float time;
-//layout(binding=0) uniform matrices {
-//    mat4 transformNormal;
-//    mat4 transformWithProjection;
-//};
-uniform mat4 transformNormal;
-uniform mat4 transformWithProjection;
+struct Light {
+    vec3 direction;
+    vec3 ambientColor;
+    vec3 diffuseColor;
+    vec3 specularColor;
+};
+
+layout(std140, binding = 0) uniform Frame {
+    mat4 viewProjection;
+    vec3 view;
+    float time;
+    Light light;
+};
+
+layout(std140, binding = 1) uniform Object {
+    mat4 transform;
+    mat4 transformNormal;
+};
 
 in vec3 position;
 in vec3 normal;
@@ -19,5 +30,5 @@ void main(void) {
     fragNormal = mat3(transformNormal) * normal;
     fragTexCoords = texCoords;
     vec3 movement = vec3(0.1 * sin(time * 10), 0.05 * sin(time * 50), 0.1 * cos(time * 10));
-    gl_Position = transformWithProjection * vec4(position + movement, 1);
+    gl_Position = viewProjection * transform * vec4(position + movement, 1);
 }
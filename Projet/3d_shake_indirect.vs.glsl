@@ -0,0 +1,49 @@
+#version 430
+
+struct Light {
+    vec3 direction;
+    vec3 ambientColor;
+    vec3 diffuseColor;
+    vec3 specularColor;
+};
+
+layout(std140, binding = 0) uniform Frame {
+    mat4 viewProjection;
+    vec3 view;
+    float time;
+    Light light;
+};
+
+struct DrawData {
+    mat4 transform;
+    mat4 transformNormal;
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    // w: shininess
+    vec4 specularColor;
+    // Layer in textureArray, or index in textureHandles
+    uint textureIndex;
+};
+
+layout(std430, binding = 2) readonly buffer Draws {
+    DrawData draws[];
+};
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texCoords;
+// baseInstance of the indirect command
+layout(location = 3) in uint drawId;
+
+out vec3 fragNormal;
+out vec2 fragTexCoords;
+flat out uint fragDrawId;
+
+void main(void) {
+    DrawData draw = draws[drawId];
+    fragNormal = mat3(draw.transformNormal) * normal;
+    fragTexCoords = texCoords;
+    fragDrawId = drawId;
+    vec3 movement = vec3(0.1 * sin(time * 10), 0.05 * sin(time * 50), 0.1 * cos(time * 10));
+    gl_Position = viewProjection * draw.transform * vec4(position + movement, 1);
+}
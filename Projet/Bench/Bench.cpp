@@ -0,0 +1,63 @@
+#include "Bench.h"
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace {
+	struct Mode {
+		const char* name;
+		const char* usage;
+		int (*run)(int argc, char** argv);
+	};
+
+	const Mode MODES[] = {
+		{ "mesh-load", "[vertices...]  time and peak memory of Mesh::load on generated grids (default 10000 1000000 10000000)", benchMeshLoad },
+		{ "mesh-cache", "[vertices]  parse and cache read times, cache invalidation and validation checks (default 1000000)", benchMeshCache },
+		{ "obj-parse", "[files...]  LoadObjParallel against LoadObj on a generated file and the given ones, with timings", benchObjParse },
+		{ "decimal-parse", "[iterations]  fast decimal path of the OBJ parser against strtod, then its speed (default 1000000)", benchDecimalParse },
+		{ "cull", "[objects]  cullBoxes against the plane test, per frame over a moving camera (default 100000)", benchCull },
+		{ "bvh", "[objects]  Bvh build, culling and raycasts against brute force, updates and refit (default 100000)", benchBvh },
+		{ "render-queue", "[draws]  RenderQueue::sort against std::stable_sort on random, byte-sharing and duplicate keys, then its speed (default 100000)", benchRenderQueue },
+		{ "bc", "[images...]  BC1/BC3 round trip PSNR and encoding speed on generated images and the given ones", benchBlockCompression },
+		{ "mip", "[width [height]]  mip chain sizes and linear mean on odd sizes, then its speed (default 2048)", benchMipChain },
+	};
+}
+
+double peakMemoryMiB() {
+#ifdef __linux__
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+		if (line.compare(0, 6, "VmHWM:") == 0)
+			return std::stod(line.substr(6)) / 1024;
+#endif
+	return 0;
+}
+
+void resetPeakMemory() {
+#ifdef __linux__
+	// "5" resets VmHWM to the current resident size
+	std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+bool check(bool condition, const char* what) {
+	if (!condition)
+		std::printf("FAILED: %s\n", what);
+	return condition;
+}
+
+int main(int argc, char** argv) {
+#ifndef NDEBUG
+	std::printf("Bench: assertions are enabled, configure with -DCMAKE_BUILD_TYPE=Release for meaningful timings\n");
+#endif
+	if (argc >= 2) {
+		for (const Mode& mode : MODES)
+			if (std::strcmp(argv[1], mode.name) == 0)
+				return mode.run(argc - 2, argv + 2);
+	}
+	std::printf("Usage: Bench <mode> [arguments]\n");
+	for (const Mode& mode : MODES)
+		std::printf("  %s %s\n", mode.name, mode.usage);
+	return 2;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// Checks and measurements of the CPU-side modules, run without a window or a GL context.
+// Each mode returns the process exit code: non-zero when one of its checks fails
+
+int benchMeshLoad(int argc, char** argv);
+int benchMeshCache(int argc, char** argv);
+int benchObjParse(int argc, char** argv);
+int benchDecimalParse(int argc, char** argv);
+int benchCull(int argc, char** argv);
+int benchBvh(int argc, char** argv);
+int benchRenderQueue(int argc, char** argv);
+int benchBlockCompression(int argc, char** argv);
+int benchMipChain(int argc, char** argv);
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Peak resident memory since the last resetPeakMemory(), in MiB; 0 where the platform cannot tell
+double peakMemoryMiB();
+void resetPeakMemory();
+
+// Prints the failure and returns false, so that checks can be chained with &=
+bool check(bool condition, const char* what);
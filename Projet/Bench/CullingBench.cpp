@@ -0,0 +1,221 @@
+#include "Bench.h"
+#include "Bvh.h"
+#include "Culling.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+namespace {
+	// Objects scattered over a square world, as seen from a camera walking through it
+	struct Scene {
+		std::vector<glm::vec3> boundsMin;
+		std::vector<glm::vec3> boundsMax;
+		std::vector<glm::mat4> transforms;
+
+		Scene(size_t count, std::mt19937& random) {
+			float side = 20 * std::sqrt(float(count));
+			std::uniform_real_distribution<float> position(-side / 2, side / 2), size(0.5f, 4), angle(0, 6.2831853f);
+			for (size_t i = 0; i < count; i++) {
+				glm::vec3 extent = { size(random), size(random), size(random) };
+				this->boundsMin.push_back(-extent);
+				this->boundsMax.push_back(extent);
+				glm::mat4 transform = glm::translate(glm::mat4(1), { position(random), position(random) * 0.05f, position(random) });
+				this->transforms.push_back(glm::rotate(transform, angle(random), { 0, 1, 0 }));
+			}
+		}
+
+		static Frustum view(int frame, size_t count) {
+			float side = 20 * std::sqrt(float(count));
+			float angle = float(frame) * 0.1f;
+			glm::vec3 eye = { std::cos(angle) * side * 0.25f, 10, std::sin(angle) * side * 0.25f };
+			glm::mat4 camera = glm::lookAt(eye, eye + glm::vec3(-std::sin(angle), -0.1f, std::cos(angle)), { 0, 1, 0 });
+			return Frustum::fromMatrix(glm::perspective(glm::radians(70.f), 16.f / 9.f, 0.1f, side * 0.5f) * camera);
+		}
+	};
+
+	// Smallest (distance + radius) over the planes: negative when outside. `scale` bounds the rounding error
+	float planeMargin(const Frustum& frustum, const glm::vec3& center, const glm::vec3& extent, float& scale) {
+		float margin = INFINITY;
+		scale = 0;
+		for (const glm::vec4& plane : frustum.planes) {
+			glm::vec3 normal = glm::vec3(plane);
+			float distance = glm::dot(normal, center) + plane.w;
+			float radius = glm::dot(glm::abs(normal), extent);
+			margin = std::min(margin, distance + radius);
+			scale = std::max(scale, glm::dot(glm::abs(normal), glm::abs(center) + extent) + std::fabs(plane.w));
+		}
+		return margin;
+	}
+
+	// Disagreements with the plane test are only accepted within rounding distance of a plane
+	bool sameVisibility(const Frustum& frustum, const CullingBoxes& boxes, const uint8_t* visible, size_t& mismatches) {
+		for (size_t i = 0; i < boxes.size(); i++) {
+			glm::vec3 center = { boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i] };
+			glm::vec3 extent = { boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i] };
+			float scale;
+			float margin = planeMargin(frustum, center, extent, scale);
+			if ((margin >= 0) != (visible[i] != 0)) {
+				if (std::fabs(margin) > 1e-5f * scale)
+					return false;
+				mismatches++;
+			}
+		}
+		return true;
+	}
+}
+
+int benchCull(int argc, char** argv) {
+	size_t count = argc > 0 ? size_t(std::strtoull(argv[0], nullptr, 10)) : 100000;
+	const int FRAMES = 50;
+	std::mt19937 random(7);
+	Scene scene(count, random);
+
+	CullingBoxes boxes;
+	boxes.resize(count);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; i++)
+		boxes.set(i, scene.boundsMin[i], scene.boundsMax[i], scene.transforms[i]);
+	double setMs = elapsedMs(start);
+
+	bool passed = true;
+	std::vector<uint8_t> visible(count);
+	size_t visibleTotal = 0, referenceTotal = 0, nearPlane = 0;
+	double cullMs = 0, referenceMs = 0;
+	for (int frame = 0; frame < FRAMES; frame++) {
+		Frustum frustum = Scene::view(frame, count);
+		start = std::chrono::steady_clock::now();
+		visibleTotal += cullBoxes(frustum, boxes, visible.data());
+		cullMs += elapsedMs(start);
+		passed &= check(sameVisibility(frustum, boxes, visible.data(), nearPlane), "cullBoxes matches the plane test");
+
+		// One box at a time, as a plain loop over the objects would
+		start = std::chrono::steady_clock::now();
+		size_t referenceVisible = 0;
+		for (size_t i = 0; i < count; i++) {
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++) {
+				const glm::vec4& plane = frustum.planes[p];
+				inside = plane.x * boxes.centerX[i] + plane.y * boxes.centerY[i] + plane.z * boxes.centerZ[i] + plane.w
+					+ std::fabs(plane.x) * boxes.extentX[i] + std::fabs(plane.y) * boxes.extentY[i] + std::fabs(plane.z) * boxes.extentZ[i] >= 0;
+			}
+			referenceVisible += inside;
+		}
+		referenceMs += elapsedMs(start);
+		referenceTotal += referenceVisible;
+	}
+
+	std::printf("cull: %zu objects, %.1f%% visible on average, %zu boxes on a plane rounded the other way\n",
+		count, 100.0 * double(visibleTotal) / double(count * FRAMES), nearPlane);
+	std::printf("cull: boxes set in %.2f ms, cullBoxes %.3f ms per frame (%.2f ns per object), one by one %.3f ms (%zu visible)\n",
+		setMs, cullMs / FRAMES, cullMs * 1e6 / double(count * FRAMES), referenceMs / FRAMES, referenceTotal / FRAMES);
+	return passed ? 0 : 1;
+}
+
+int benchBvh(int argc, char** argv) {
+	size_t count = argc > 0 ? size_t(std::strtoull(argv[0], nullptr, 10)) : 100000;
+	const int FRAMES = 50;
+	const int RAYS = 2000;
+	std::mt19937 random(11);
+	Scene scene(count, random);
+
+	// World boxes, as the BVH stores them
+	std::vector<glm::vec3> boundsMin(count), boundsMax(count);
+	CullingBoxes boxes;
+	boxes.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		boxes.set(i, scene.boundsMin[i], scene.boundsMax[i], scene.transforms[i]);
+		glm::vec3 center = { boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i] };
+		glm::vec3 extent = { boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i] };
+		boundsMin[i] = center - extent;
+		boundsMax[i] = center + extent;
+	}
+
+	Bvh bvh;
+	auto start = std::chrono::steady_clock::now();
+	bvh.build(boundsMin, boundsMax);
+	double buildMs = elapsedMs(start);
+
+	bool passed = true;
+	std::vector<uint8_t> visible(count);
+	size_t nearPlane = 0;
+	uint32_t nodesVisited = 0;
+	double cullMs = 0;
+	auto cullFrames = [&]() {
+		for (int frame = 0; frame < FRAMES; frame++) {
+			Frustum frustum = Scene::view(frame, count);
+			start = std::chrono::steady_clock::now();
+			bvh.cullFrustum(frustum, visible.data(), nodesVisited);
+			cullMs += elapsedMs(start);
+			passed &= check(sameVisibility(frustum, boxes, visible.data(), nearPlane), "Bvh::cullFrustum matches the plane test");
+		}
+	};
+	cullFrames();
+
+	// Nearest hit against every box, from random points toward random directions. The rays are timed apart from
+	// the brute force, which would evict the tree from the cache
+	std::uniform_real_distribution<float> unit(-1, 1);
+	float side = 20 * std::sqrt(float(count));
+	std::vector<glm::vec3> origins(RAYS), directions(RAYS);
+	std::vector<float> distances(RAYS);
+	std::vector<uint32_t> rayHits(RAYS);
+	for (int r = 0; r < RAYS; r++) {
+		origins[r] = { unit(random) * side / 2, 5 + unit(random) * 4, unit(random) * side / 2 };
+		directions[r] = { unit(random), unit(random) * 0.1f, unit(random) };
+	}
+	uint32_t rayNodes = 0, hits = 0;
+	start = std::chrono::steady_clock::now();
+	for (int r = 0; r < RAYS; r++)
+		rayHits[r] = bvh.raycast(origins[r], directions[r], distances[r], rayNodes);
+	double raycastMs = elapsedMs(start);
+	for (int r = 0; r < RAYS; r++) {
+		float nearest = FLT_MAX;
+		glm::vec3 inverseDirection = 1.f / directions[r];
+		for (size_t i = 0; i < count; i++) {
+			glm::vec3 t0 = (boundsMin[i] - origins[r]) * inverseDirection, t1 = (boundsMax[i] - origins[r]) * inverseDirection;
+			glm::vec3 near = glm::min(t0, t1), far = glm::max(t0, t1);
+			float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.f));
+			float exit = std::min(std::min(far.x, far.y), far.z);
+			if (enter <= exit)
+				nearest = std::min(nearest, enter);
+		}
+		hits += rayHits[r] != Bvh::NONE;
+		if ((rayHits[r] == Bvh::NONE) != (nearest == FLT_MAX) || (rayHits[r] != Bvh::NONE && distances[r] != nearest)) {
+			passed &= check(false, "Bvh::raycast finds the nearest box");
+			break;
+		}
+	}
+
+	// 1% of the objects move each frame: one by one through update, or all at once through refit
+	std::uniform_real_distribution<float> step(-3, 3);
+	size_t moving = std::max<size_t>(count / 100, 1);
+	start = std::chrono::steady_clock::now();
+	for (size_t m = 0; m < moving; m++) {
+		uint32_t item = uint32_t(random() % count);
+		glm::vec3 offset = { step(random), step(random), step(random) };
+		boxes.centerX[item] += offset.x;
+		boxes.centerY[item] += offset.y;
+		boxes.centerZ[item] += offset.z;
+		boundsMin[item] += offset;
+		boundsMax[item] += offset;
+		bvh.update(item, boundsMin[item], boundsMax[item]);
+	}
+	double updateMs = elapsedMs(start);
+	start = std::chrono::steady_clock::now();
+	bvh.refit();
+	double refitMs = elapsedMs(start);
+	double cullBeforeMs = cullMs;
+	uint32_t nodesBefore = nodesVisited;
+	cullMs = 0;
+	nodesVisited = 0;
+	cullFrames();
+
+	std::printf("bvh: %zu objects, %zu nodes built in %.1f ms\n", count, bvh.nodes.size(), buildMs);
+	std::printf("bvh: cullFrustum %.3f ms per frame, %u nodes visited (%.3f ms, %u nodes after moving %zu objects)\n",
+		cullBeforeMs / FRAMES, nodesBefore / FRAMES, cullMs / FRAMES, nodesVisited / FRAMES, moving);
+	std::printf("bvh: raycast %.2f us per ray, %u nodes visited, %d of %d rays hit\n",
+		raycastMs * 1000 / RAYS, rayNodes / RAYS, int(hits), RAYS);
+	std::printf("bvh: %zu updates in %.2f ms, refit in %.2f ms\n", moving, updateMs, refitMs);
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#include "Bench.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+namespace {
+	// Square grid of about `vertexCount` vertices, two triangles per cell, every corner v/vt/vn
+	bool writeGrid(const std::string& file, size_t vertexCount, size_t& side, const char* materialLibrary = nullptr) {
+		side = 2;
+		while (side * side < vertexCount)
+			side++;
+		FILE* out = std::fopen(file.c_str(), "wb");
+		if (!out)
+			return false;
+		if (materialLibrary)
+			std::fprintf(out, "mtllib %s\nusemtl grid\n", materialLibrary);
+		for (size_t y = 0; y < side; y++)
+			for (size_t x = 0; x < side; x++)
+				std::fprintf(out, "v %g %g %g\n", double(x), double(y) * 0.5, double((x * 7 + y * 3) % 11) * 0.1);
+		for (size_t y = 0; y < side; y++)
+			for (size_t x = 0; x < side; x++)
+				std::fprintf(out, "vt %g %g\n", double(x) / double(side - 1), double(y) / double(side - 1));
+		std::fprintf(out, "vn 0 0 1\n");
+		for (size_t y = 0; y + 1 < side; y++) {
+			for (size_t x = 0; x + 1 < side; x++) {
+				size_t a = y * side + x + 1, b = a + 1, c = a + side, d = c + 1;
+				std::fprintf(out, "f %zu/%zu/1 %zu/%zu/1 %zu/%zu/1\nf %zu/%zu/1 %zu/%zu/1 %zu/%zu/1\n", a, a, b, b, d, d, a, a, d, d, c, c);
+			}
+		}
+		return std::fclose(out) == 0;
+	}
+
+	// Moves the mtime of a file without changing its content
+	bool touch(const std::string& file, time_t offset) {
+		struct stat info = {};
+		if (stat(file.c_str(), &info) != 0)
+			return false;
+		struct utimbuf times = { info.st_atime, info.st_mtime + offset };
+		return utime(file.c_str(), &times) == 0;
+	}
+
+	bool readCache(const std::string& objFile, Mesh& mesh, FileStamp& stamp) {
+		return stampFile(objFile, stamp) && readMeshCache(objFile + MESH_CACHE_EXTENSION, stamp, false, mesh);
+	}
+}
+
+int benchMeshLoad(int argc, char** argv) {
+	std::vector<size_t> sizes;
+	for (int i = 0; i < argc; i++)
+		sizes.push_back(size_t(std::strtoull(argv[i], nullptr, 10)));
+	if (sizes.empty())
+		sizes = { 10000, 1000000, 10000000 };
+
+	bool passed = true;
+	for (size_t size : sizes) {
+		std::string file = "bench_grid_" + std::to_string(size) + ".obj";
+		size_t side;
+		if (!writeGrid(file, size, side)) {
+			std::printf("mesh-load: cannot write %s\n", file.c_str());
+			return 1;
+		}
+
+		resetPeakMemory();
+		double baseMiB = peakMemoryMiB();
+		auto start = std::chrono::steady_clock::now();
+		Mesh mesh;
+		bool loaded = mesh.load(file);
+		double ms = elapsedMs(start);
+		double peakMiB = peakMemoryMiB();
+		double outputMiB = double(mesh.vertices.size() * sizeof(Vertex3) + mesh.indices.size() * sizeof(uint32_t)) / (1024 * 1024);
+		std::remove(file.c_str());
+
+		std::printf("mesh-load: %zu vertices, %zu indices in %.1f ms, peak +%.1f MiB for %.1f MiB of output (%.0f bytes per vertex)\n",
+			mesh.vertices.size(), mesh.indices.size(), ms, peakMiB - baseMiB, outputMiB,
+			(peakMiB - baseMiB) * 1024 * 1024 / double(std::max<size_t>(mesh.vertices.size(), 1)));
+		// Every grid point is one (v, vt, vn) triplet, so welding must give exactly one vertex per point
+		passed &= check(loaded, "mesh loads");
+		passed &= check(mesh.vertices.size() == side * side, "one welded vertex per grid point");
+		passed &= check(mesh.indices.size() == 6 * (side - 1) * (side - 1), "six indices per cell");
+	}
+	return passed ? 0 : 1;
+}
+
+int benchMeshCache(int argc, char** argv) {
+	size_t size = argc > 0 ? size_t(std::strtoull(argv[0], nullptr, 10)) : 1000000;
+	const std::string objFile = "bench_cache.obj";
+	const std::string mtlFile = "bench_cache.mtl";
+	const std::string cacheFile = objFile + MESH_CACHE_EXTENSION;
+	size_t side;
+	std::ofstream(mtlFile) << "newmtl grid\nKd 0.5 0.5 0.5\n";
+	if (!writeGrid(objFile, size, side, mtlFile.c_str())) {
+		std::printf("mesh-cache: cannot write %s\n", objFile.c_str());
+		return 1;
+	}
+	std::remove(cacheFile.c_str());
+
+	bool passed = true;
+	auto start = std::chrono::steady_clock::now();
+	Mesh parsed;
+	passed &= check(parsed.loadCached(objFile, false), "first load parses and writes the cache");
+	double coldMs = elapsedMs(start);
+	start = std::chrono::steady_clock::now();
+	Mesh cached;
+	passed &= check(cached.loadCached(objFile, false), "second load");
+	double warmMs = elapsedMs(start);
+	std::printf("mesh-cache: %zu vertices, parse + write %.1f ms, cache read %.1f ms\n", parsed.vertices.size(), coldMs, warmMs);
+
+	Mesh mesh;
+	FileStamp stamp;
+	passed &= check(readCache(objFile, mesh, stamp), "cache is valid after writing it");
+	passed &= check(mesh.vertices.size() == parsed.vertices.size()
+		&& mesh.indices == parsed.indices && mesh.materialFiles == parsed.materialFiles, "cache holds the parsed mesh");
+	passed &= check(mesh.materialFiles.size() == 1 && mesh.materialFiles[0] == mtlFile, "material library is recorded");
+
+	// Touched but unchanged: matched through the hash once, then through the rewritten mtime
+	passed &= check(touch(objFile, 10) && touch(mtlFile, 10), "touch sources");
+	passed &= check(readCache(objFile, mesh, stamp) && stamp.hash != 0, "touched sources match through their hash");
+	passed &= check(readCache(objFile, mesh, stamp) && stamp.hash == 0, "matched stamps are rewritten");
+
+	std::ofstream(mtlFile, std::ios::app) << "Ks 1 1 1\n";
+	passed &= check(!readCache(objFile, mesh, stamp), "edited material library invalidates the cache");
+	passed &= check(parsed.loadCached(objFile, false) && readCache(objFile, mesh, stamp), "cache is rebuilt");
+
+	// Damaged caches are rejected without trusting their counts
+	{
+		std::ifstream in(cacheFile, std::ios::binary);
+		std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		in.close();
+		std::ofstream(cacheFile, std::ios::binary | std::ios::trunc).write(bytes.data(), std::streamsize(bytes.size() / 2));
+		passed &= check(!readCache(objFile, mesh, stamp), "truncated cache is rejected");
+	}
+	parsed.indices[parsed.indices.size() / 2] = uint32_t(parsed.vertices.size());
+	passed &= check(stampFile(objFile, stamp) && writeMeshCache(cacheFile, stamp, false, parsed), "write damaged cache");
+	passed &= check(!readCache(objFile, mesh, stamp), "out of range index is rejected");
+
+	std::remove(objFile.c_str());
+	std::remove(mtlFile.c_str());
+	std::remove(cacheFile.c_str());
+	return passed ? 0 : 1;
+}
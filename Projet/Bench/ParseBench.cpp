@@ -0,0 +1,282 @@
+// The implementation of tiny_obj_loader lives in this translation unit, which also gives the decimal checks
+// access to its internal functions
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+#include "Bench.h"
+#include "MappedFile.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace {
+	struct ObjData {
+		bool parsed = false;
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+	};
+
+	bool sameIndices(const std::vector<tinyobj::index_t>& a, const std::vector<tinyobj::index_t>& b) {
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); i++)
+			if (a[i].vertex_index != b[i].vertex_index || a[i].normal_index != b[i].normal_index
+					|| a[i].texcoord_index != b[i].texcoord_index)
+				return false;
+		return true;
+	}
+
+	bool sameResult(const ObjData& a, const ObjData& b) {
+		if (a.parsed != b.parsed || a.attrib.vertices != b.attrib.vertices || a.attrib.vertex_weights != b.attrib.vertex_weights
+				|| a.attrib.normals != b.attrib.normals || a.attrib.texcoords != b.attrib.texcoords
+				|| a.attrib.colors != b.attrib.colors || a.shapes.size() != b.shapes.size() || a.materials.size() != b.materials.size())
+			return false;
+		for (size_t s = 0; s < a.shapes.size(); s++) {
+			const tinyobj::shape_t& x = a.shapes[s];
+			const tinyobj::shape_t& y = b.shapes[s];
+			if (x.name != y.name || !sameIndices(x.mesh.indices, y.mesh.indices) || x.mesh.num_face_vertices != y.mesh.num_face_vertices
+					|| x.mesh.material_ids != y.mesh.material_ids || x.mesh.smoothing_group_ids != y.mesh.smoothing_group_ids
+					|| !sameIndices(x.lines.indices, y.lines.indices) || x.lines.num_line_vertices != y.lines.num_line_vertices
+					|| !sameIndices(x.points.indices, y.points.indices))
+				return false;
+		}
+		for (size_t m = 0; m < a.materials.size(); m++)
+			if (a.materials[m].name != b.materials[m].name)
+				return false;
+		return true;
+	}
+
+	ObjData parseSerial(const std::string& text, const std::string& searchPath) {
+		ObjData data;
+		std::istringstream in(text);
+		tinyobj::MaterialFileReader reader(searchPath);
+		std::string warning, error;
+		data.parsed = tinyobj::LoadObj(&data.attrib, &data.shapes, &data.materials, &warning, &error, &in, &reader);
+		return data;
+	}
+
+	ObjData parseParallel(const std::string& text, const std::string& searchPath, unsigned int threads) {
+		ObjData data;
+		tinyobj::MaterialFileReader reader(searchPath);
+		std::string warning, error;
+		data.parsed = tinyobj::LoadObjParallel(&data.attrib, &data.shapes, &data.materials, &warning, &error,
+			text.data(), text.size(), &reader, true, true, threads);
+		return data;
+	}
+
+	// Every statement the parser knows, in varied forms, so that chunk boundaries fall everywhere
+	std::string generateObj(size_t faceCount) {
+		std::ostringstream out;
+		out << "# generated\nmtllib bench_parse_a.mtl\n";
+		size_t vertices = 0;
+		for (size_t f = 0; f < faceCount; f++) {
+			switch (f % 97) {
+			case 0: out << "o object" << f << "\n"; break;
+			case 13: out << "g group" << f << " second\n"; break;
+			case 29: out << "usemtl " << (f % 2 ? "a" : "b") << "\n"; break;
+			case 41: out << "s " << (f % 5) << "\n"; break;
+			case 53: out << "s off\n"; break;
+			case 61: out << "mtllib bench_parse_a.mtl bench_parse_b.mtl\n"; break;
+			case 67: out << "# comment line\n\n"; break;
+			default: break;
+			}
+			for (int k = 0; k < 4; k++) {
+				double x = double((f * 31 + k * 7) % 1000) * 0.01;
+				if (f % 3 == 0)
+					out << "v " << x << " " << -x << " " << x * 2 << " 0.5 0.25 1\n";
+				else
+					out << "v " << x << " " << x * 0.5 << " " << -x << "\n";
+				out << "vt " << x * 0.1 << " " << 1 - x * 0.1 << "\n";
+				out << "vn 0 " << (k % 2) << " " << 1 - k % 2 << "\n";
+			}
+			vertices += 4;
+			size_t a = vertices - 3;
+			switch (f % 5) {
+			case 0: out << "f " << a << " " << a + 1 << " " << a + 2 << "\n"; break;
+			case 1: out << "f " << a << "/" << a << " " << a + 1 << "/" << a + 1 << " " << a + 2 << "/" << a + 2 << " " << a + 3 << "/" << a + 3 << "\n"; break;
+			case 2: out << "f " << a << "//" << a << " " << a + 1 << "//" << a + 1 << " " << a + 2 << "//" << a + 2 << "\n"; break;
+			case 3: out << "f -4/-4/-4 -3/-3/-3 -2/-2/-2 -1/-1/-1\n"; break;
+			default: out << "f " << a << "/" << a << "/" << a << " " << a + 1 << "/" << a + 1 << "/" << a + 1 << " " << a + 2 << "/" << a + 2 << "/" << a + 2 << "\n"; break;
+			}
+			if (f % 211 == 0)
+				out << "l " << a << " " << a + 1 << " " << a + 2 << "\np " << a + 3 << "\n";
+		}
+		return out.str();
+	}
+
+	// Digits only, without the SWAR tricks
+	bool parseEightDigitsReference(const char* s, unsigned int* value) {
+		unsigned int result = 0;
+		for (int i = 0; i < 8; i++) {
+			if (s[i] < '0' || s[i] > '9')
+				return false;
+			result = result * 10 + unsigned(s[i] - '0');
+		}
+		*value = result;
+		return true;
+	}
+
+	// When the fast path accepts a number, it must be exactly what strtod reads
+	bool checkDecimal(const std::string& text, bool mustAccept, size_t& accepted) {
+		double fast = 0;
+		bool fastAccepted = tinyobj::tryParseDecimalFast(text.data(), text.data() + text.size(), &fast);
+		if (!fastAccepted) {
+			if (mustAccept)
+				std::printf("decimal-parse: \"%s\" ", text.c_str());
+			return check(!mustAccept, "plain decimal is taken by the fast path");
+		}
+		accepted++;
+		char* end = nullptr;
+		double reference = std::strtod(text.c_str(), &end);
+		if (end != text.c_str() + text.size() || std::memcmp(&fast, &reference, sizeof(double)) != 0) {
+			std::printf("decimal-parse: \"%s\" gives %.17g, strtod %.17g ", text.c_str(), fast, reference);
+			return check(false, "fast path matches strtod");
+		}
+		return true;
+	}
+
+	bool compare(const std::string& name, const std::string& text, const std::string& searchPath) {
+		auto start = std::chrono::steady_clock::now();
+		ObjData serial = parseSerial(text, searchPath);
+		double serialMs = elapsedMs(start);
+		bool passed = check(serial.parsed, "serial parse");
+		double parallelMs = 0;
+		for (unsigned int threads : { 0u, 1u, 2u, 3u, 7u, 16u }) {
+			start = std::chrono::steady_clock::now();
+			ObjData parallel = parseParallel(text, searchPath, threads);
+			if (threads == 0)
+				parallelMs = elapsedMs(start);
+			if (!sameResult(serial, parallel)) {
+				std::printf("%s: %u threads: ", name.c_str(), threads);
+				passed &= check(false, "parallel parse matches the serial one");
+			}
+		}
+		std::printf("obj-parse: %s, %zu KiB, serial %.1f ms, parallel %.1f ms\n", name.c_str(), text.size() / 1024, serialMs, parallelMs);
+		return passed;
+	}
+}
+
+int benchObjParse(int argc, char** argv) {
+	std::ofstream("bench_parse_a.mtl") << "newmtl a\nKd 1 0 0\n";
+	std::ofstream("bench_parse_b.mtl") << "newmtl b\nKd 0 1 0\n";
+	std::string generated = generateObj(20000);
+	bool passed = compare("generated", generated, "");
+
+	// A library listed again next to a new one: the new one must still be loaded
+	ObjData libraries = parseSerial("mtllib bench_parse_a.mtl\nmtllib bench_parse_a.mtl bench_parse_b.mtl\n", "");
+	passed &= check(libraries.materials.size() == 2, "repeated mtllib does not skip the next library");
+	std::remove("bench_parse_a.mtl");
+	std::remove("bench_parse_b.mtl");
+
+	for (int i = 0; i < argc; i++) {
+		MappedFile file;
+		if (!file.open(argv[i])) {
+			std::printf("obj-parse: cannot open %s\n", argv[i]);
+			return 1;
+		}
+		std::string path = argv[i];
+		size_t separator = path.find_last_of("/\\");
+		std::string searchPath = separator == std::string::npos ? "" : path.substr(0, separator);
+		passed &= compare(path, std::string(reinterpret_cast<const char*>(file.data), file.size), searchPath);
+	}
+	return passed ? 0 : 1;
+}
+
+int benchDecimalParse(int argc, char** argv) {
+	size_t iterations = argc > 0 ? size_t(std::strtoull(argv[0], nullptr, 10)) : 1000000;
+	std::mt19937_64 random(42);
+	bool passed = true;
+	size_t accepted = 0;
+
+	// parseEightDigits on digits and on their ASCII neighbours, where the SWAR range check is the tightest
+	const char eightDigitsAlphabet[] = "0123456789/:. \x7F\xB0\xB9";
+	for (size_t i = 0; i < iterations && passed; i++) {
+		char bytes[8];
+		for (char& byte : bytes)
+			byte = random() % 4 ? char('0' + random() % 10) : eightDigitsAlphabet[random() % (sizeof(eightDigitsAlphabet) - 1)];
+		unsigned int fast = 0, reference = 0;
+		bool fastParsed = tinyobj::parseEightDigits(bytes, &fast);
+		if (fastParsed != parseEightDigitsReference(bytes, &reference) || (fastParsed && fast != reference))
+			passed &= check(false, "parseEightDigits matches the scalar loop");
+	}
+
+	// Edge cases: leading zeros, 8 and 16 digit boundaries of the SWAR loop, the 2^53 and 19 digit limits, forms
+	// left to the general path (exponents, denormals, too many digits)
+	const char* const plain[] = {
+		"0", "-0", "+0", "0.", ".5", "-.5", "1.", "00000000", "00000000.00000001", "0000000000000001.5",
+		"12345678", "123456789", "1234567.8", "12345678.12345678", "1234567812345678", "0.1234567812345678",
+		"-9007199254740992", "0.9007199254740992", "9999999999999999", "4.9406564584124654", "0.30000000000000004",
+		"340282346638528859811704183484516925440", "1234567890123456789",
+	};
+	for (const char* text : plain) {
+		// Up to 15 digits always fit the double mantissa
+		size_t digits = 0;
+		for (const char* c = text; *c; c++)
+			digits += *c >= '0' && *c <= '9';
+		passed &= checkDecimal(text, digits <= 15, accepted);
+	}
+	const char* const rejected[] = {
+		"", "-", "+", ".", "-.", "1e5", "1E-5", "4.9e-324", "2.2250738585072014e-308", "1.5e308",
+		"9007199254740993", "12345678901234567890", "1..2", "1.2.3", "12345678a", "0x10", "inf", "nan", " 1", "1 ",
+		"0.00000000000000000000000000001",
+	};
+	for (const char* text : rejected) {
+		double value;
+		if (tinyobj::tryParseDecimalFast(text, text + std::strlen(text), &value) && std::strlen(text) > 0) {
+			// Accepting is fine as long as the value is right
+			passed &= checkDecimal(text, false, accepted);
+		}
+	}
+
+	// Random decimals of every length, with occasional signs, exponents and stray characters
+	for (size_t i = 0; i < iterations; i++) {
+		std::string text;
+		if (random() % 3 == 0)
+			text += random() % 2 ? '-' : '+';
+		size_t integerDigits = random() % 21, fractionDigits = random() % 21;
+		for (size_t d = 0; d < integerDigits; d++)
+			text += char('0' + random() % 10);
+		if (random() % 4 != 0) {
+			text += '.';
+			for (size_t d = 0; d < fractionDigits; d++)
+				text += char('0' + random() % 10);
+		}
+		if (random() % 16 == 0)
+			text += "e" + std::to_string(int(random() % 700) - 350);
+		if (random() % 32 == 0)
+			text.insert(random() % (text.size() + 1), 1, "x./- "[random() % 5]);
+		passed &= checkDecimal(text, false, accepted);
+		if (!passed)
+			break;
+	}
+	std::printf("decimal-parse: %zu numbers taken by the fast path and compared to strtod\n", accepted);
+
+	// Typical vertex coordinates, as found in `v` lines
+	std::vector<std::string> samples;
+	for (size_t i = 0; i < 100000; i++) {
+		char text[32];
+		std::snprintf(text, sizeof(text), "%.6f", (double(random() % 2000000) - 1000000) / 1000.0);
+		samples.emplace_back(text);
+	}
+	double sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int repeat = 0; repeat < 10; repeat++) {
+		for (const std::string& text : samples) {
+			double value = 0;
+			tinyobj::tryParseDecimalFast(text.data(), text.data() + text.size(), &value);
+			sum += value;
+		}
+	}
+	double fastMs = elapsedMs(start);
+	start = std::chrono::steady_clock::now();
+	for (int repeat = 0; repeat < 10; repeat++)
+		for (const std::string& text : samples)
+			sum -= std::strtod(text.c_str(), nullptr);
+	double strtodMs = elapsedMs(start);
+	std::printf("decimal-parse: fast path %.1f ns per number, strtod %.1f ns (checksum %g)\n",
+		fastMs * 1e6 / double(10 * samples.size()), strtodMs * 1e6 / double(10 * samples.size()), sum);
+	return passed ? 0 : 1;
+}
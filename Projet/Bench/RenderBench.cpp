@@ -0,0 +1,98 @@
+#include "Bench.h"
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+
+namespace {
+	bool byKey(const RenderItem& a, const RenderItem& b) {
+		return a.key < b.key;
+	}
+
+	// Sorts a copy of `keys` both ways; items carry their push order, so equal keys must keep it
+	bool sameOrder(RenderQueue& queue, const std::vector<uint64_t>& keys) {
+		queue.clear();
+		for (size_t i = 0; i < keys.size(); i++)
+			queue.push(keys[i], uint32_t(i));
+		std::vector<RenderItem> reference = queue.items;
+		std::stable_sort(reference.begin(), reference.end(), byKey);
+		queue.sort();
+		if (queue.items.size() != reference.size())
+			return false;
+		for (size_t i = 0; i < reference.size(); i++)
+			if (queue.items[i].key != reference[i].key || queue.items[i].index != reference[i].index)
+				return false;
+		return true;
+	}
+
+	// Keys as a frame would push them: few programs and textures, one pass, depth spread over the range
+	std::vector<uint64_t> sceneKeys(size_t count, std::mt19937& random) {
+		std::uniform_int_distribution<uint32_t> program(1, 6), texture(1, 40), vao(1, 200);
+		std::uniform_real_distribution<float> depth(0, 1);
+		std::vector<uint64_t> keys(count);
+		for (uint64_t& key : keys)
+			key = RenderQueue::makeKey(0, program(random), texture(random), vao(random), depth(random));
+		return keys;
+	}
+}
+
+int benchRenderQueue(int argc, char** argv) {
+	size_t count = argc > 0 ? size_t(std::strtoull(argv[0], nullptr, 10)) : 100000;
+	const int FRAMES = 50;
+	std::mt19937_64 random64(5);
+	std::mt19937 random(5);
+	RenderQueue queue;
+	bool passed = true;
+
+	std::vector<uint64_t> keys(count);
+	for (uint64_t& key : keys)
+		key = random64();
+	passed &= check(sameOrder(queue, keys), "random keys sort like std::stable_sort");
+
+	// Only the low byte and byte 5 differ: every other pass is skipped
+	for (uint64_t& key : keys)
+		key = 0x1200AB0000003400ull | (random64() & 0xFF) | (random64() & 0xFF) << 40;
+	passed &= check(sameOrder(queue, keys), "keys sharing whole bytes sort like std::stable_sort");
+	passed &= check(sameOrder(queue, sceneKeys(count, random)), "scene keys sort like std::stable_sort");
+
+	// A handful of distinct keys, each pushed many times; an odd number of passes shows a scatter that reverses them
+	for (uint64_t& key : keys)
+		key = random64() % 8 * 0x010101ull;
+	passed &= check(sameOrder(queue, keys), "duplicate keys keep their push order");
+	std::fill(keys.begin(), keys.end(), 42);
+	passed &= check(sameOrder(queue, keys), "identical keys are left in place");
+	passed &= check(sameOrder(queue, { 3 }) && sameOrder(queue, {}), "single and empty queues");
+
+	// Timed on frames of scene keys, against the comparison sorts the queue replaced
+	std::vector<std::vector<uint64_t>> frames;
+	for (int frame = 0; frame < FRAMES; frame++)
+		frames.push_back(sceneKeys(count, random));
+	double radixMs = 0, stableMs = 0, sortMs = 0;
+	std::vector<RenderItem> items;
+	bool agree = true;
+	for (const std::vector<uint64_t>& frame : frames) {
+		queue.clear();
+		for (size_t i = 0; i < frame.size(); i++)
+			queue.push(frame[i], uint32_t(i));
+		items = queue.items;
+		auto start = std::chrono::steady_clock::now();
+		queue.sort();
+		radixMs += elapsedMs(start);
+
+		start = std::chrono::steady_clock::now();
+		std::stable_sort(items.begin(), items.end(), byKey);
+		stableMs += elapsedMs(start);
+		agree &= items.front().key == queue.items.front().key && items.back().key == queue.items.back().key;
+
+		items = queue.items;
+		std::shuffle(items.begin(), items.end(), random);
+		start = std::chrono::steady_clock::now();
+		std::sort(items.begin(), items.end(), byKey);
+		sortMs += elapsedMs(start);
+	}
+	passed &= check(agree, "timed sorts agree");
+
+	std::printf("render-queue: %zu draws, radix sort %.3f ms per frame (%.2f ns per draw), std::stable_sort %.3f ms, std::sort %.3f ms\n",
+		count, radixMs / FRAMES, radixMs * 1e6 / double(count * FRAMES), stableMs / FRAMES, sortMs / FRAMES);
+	return passed ? 0 : 1;
+}
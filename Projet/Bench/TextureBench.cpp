@@ -0,0 +1,256 @@
+// stb_image is implemented by main.cpp in the application: the bench, which has no main.cpp of its own, does it here
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "Bench.h"
+#include "BlockCompression.h"
+#include "MipChain.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+	// Smooth images and the bundled textures reach 36-52 dB colour, noise is only reported
+	const double BC_MIN_COLOR_PSNR = 32;
+	const double BC_MIN_ALPHA_PSNR = 40;
+
+	struct Image {
+		std::string name;
+		int width;
+		int height;
+		std::vector<uint8_t> rgba;
+	};
+
+	void decodeColors(const uint8_t* block, bool alwaysFourColors, uint8_t colors[4][4]) {
+		uint16_t endpoints[2];
+		std::memcpy(endpoints, block, sizeof(endpoints));
+		for (int e = 0; e < 2; e++) {
+			int r = endpoints[e] >> 11, g = endpoints[e] >> 5 & 63, b = endpoints[e] & 31;
+			colors[e][0] = uint8_t(r << 3 | r >> 2);
+			colors[e][1] = uint8_t(g << 2 | g >> 4);
+			colors[e][2] = uint8_t(b << 3 | b >> 2);
+			colors[e][3] = 255;
+		}
+		bool fourColors = alwaysFourColors || endpoints[0] > endpoints[1];
+		for (int c = 0; c < 3; c++) {
+			if (fourColors) {
+				colors[2][c] = uint8_t((2 * colors[0][c] + colors[1][c]) / 3);
+				colors[3][c] = uint8_t((colors[0][c] + 2 * colors[1][c]) / 3);
+			} else {
+				colors[2][c] = uint8_t((colors[0][c] + colors[1][c]) / 2);
+				colors[3][c] = 0;
+			}
+		}
+		colors[2][3] = 255;
+		colors[3][3] = fourColors ? 255 : 0;
+	}
+
+	// Reference decoders, as the S3TC specification describes them. `texels` is the 4x4 block in row order
+	void decodeBc1Block(const uint8_t* block, bool alwaysFourColors, uint8_t* texels) {
+		uint8_t colors[4][4];
+		decodeColors(block, alwaysFourColors, colors);
+		uint32_t indices;
+		std::memcpy(&indices, block + 4, sizeof(indices));
+		for (int i = 0; i < 16; i++)
+			std::memcpy(texels + 4 * i, colors[indices >> (2 * i) & 3], 4);
+	}
+
+	void decodeBc3Block(const uint8_t* block, uint8_t* texels) {
+		decodeBc1Block(block + 8, true, texels);
+		int alphas[8] = { block[0], block[1] };
+		for (int k = 2; k < 8; k++) {
+			if (alphas[0] > alphas[1])
+				alphas[k] = ((8 - k) * alphas[0] + (k - 1) * alphas[1]) / 7;
+			else if (k < 6)
+				alphas[k] = ((6 - k) * alphas[0] + (k - 1) * alphas[1]) / 5;
+			else
+				alphas[k] = k == 6 ? 0 : 255;
+		}
+		uint64_t indices = 0;
+		std::memcpy(&indices, block + 2, 6);
+		for (int i = 0; i < 16; i++)
+			texels[4 * i + 3] = uint8_t(alphas[indices >> (3 * i) & 7]);
+	}
+
+	std::vector<uint8_t> decode(const std::vector<uint8_t>& blocks, int width, int height, bool bc3) {
+		std::vector<uint8_t> rgba(size_t(4) * width * height);
+		int blocksX = (width + 3) / 4;
+		size_t blockSize = bc3 ? BC3_BLOCK_SIZE : BC1_BLOCK_SIZE;
+		for (int by = 0; by < (height + 3) / 4; by++) {
+			for (int bx = 0; bx < blocksX; bx++) {
+				uint8_t texels[64];
+				const uint8_t* block = &blocks[(size_t(by) * blocksX + bx) * blockSize];
+				if (bc3)
+					decodeBc3Block(block, texels);
+				else
+					decodeBc1Block(block, false, texels);
+				for (int y = 0; y < 4 && 4 * by + y < height; y++)
+					for (int x = 0; x < 4 && 4 * bx + x < width; x++)
+						std::memcpy(&rgba[4 * (size_t(4 * by + y) * width + 4 * bx + x)], texels + 4 * (4 * y + x), 4);
+			}
+		}
+		return rgba;
+	}
+
+	// Over the channels [first, first + count)
+	double psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int first, int count) {
+		double squares = 0;
+		for (size_t i = 0; i < a.size(); i += 4)
+			for (int c = first; c < first + count; c++)
+				squares += double(a[i + c] - b[i + c]) * double(a[i + c] - b[i + c]);
+		double mse = squares / double(a.size() / 4 * count);
+		return mse == 0 ? INFINITY : 10 * std::log10(255.0 * 255.0 / mse);
+	}
+
+	Image gradient(int width, int height) {
+		Image image = { "gradient", width, height, std::vector<uint8_t>(size_t(4) * width * height) };
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				uint8_t* texel = &image.rgba[4 * (size_t(y) * width + x)];
+				texel[0] = uint8_t(255 * x / (width - 1));
+				texel[1] = uint8_t(255 * y / (height - 1));
+				texel[2] = uint8_t(128 + 127 * std::sin(float(x + y) * 0.05f));
+				texel[3] = uint8_t(255 * (x + y) / (width + height - 2));
+			}
+		}
+		return image;
+	}
+
+	Image noise(int width, int height) {
+		Image image = { "noise", width, height, std::vector<uint8_t>(size_t(4) * width * height) };
+		std::mt19937 random(3);
+		for (uint8_t& value : image.rgba)
+			value = uint8_t(random());
+		return image;
+	}
+}
+
+int benchBlockCompression(int argc, char** argv) {
+	// Odd sizes exercise the edge blocks
+	std::vector<Image> images = { gradient(256, 256), gradient(67, 33), noise(64, 64) };
+	for (int i = 0; i < argc; i++) {
+		int width, height, channels;
+		uint8_t* pixels = stbi_load(argv[i], &width, &height, &channels, 4);
+		if (!pixels) {
+			std::printf("bc: cannot load %s\n", argv[i]);
+			return 1;
+		}
+		images.push_back({ argv[i], width, height, std::vector<uint8_t>(pixels, pixels + size_t(4) * width * height) });
+		stbi_image_free(pixels);
+	}
+
+	bool passed = true;
+	for (const Image& image : images) {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<uint8_t> bc1 = compressBc1(image.rgba.data(), image.width, image.height);
+		double bc1Ms = elapsedMs(start);
+		start = std::chrono::steady_clock::now();
+		std::vector<uint8_t> bc3 = compressBc3(image.rgba.data(), image.width, image.height);
+		double bc3Ms = elapsedMs(start);
+
+		size_t blocks = size_t((image.width + 3) / 4) * ((image.height + 3) / 4);
+		passed &= check(bc1.size() == blocks * BC1_BLOCK_SIZE && bc3.size() == blocks * BC3_BLOCK_SIZE, "one block per 4x4 texels");
+		if (!passed)
+			break;
+		std::vector<uint8_t> bc1Decoded = decode(bc1, image.width, image.height, false);
+		std::vector<uint8_t> bc3Decoded = decode(bc3, image.width, image.height, true);
+		double bc1Color = psnr(image.rgba, bc1Decoded, 0, 3);
+		double bc3Color = psnr(image.rgba, bc3Decoded, 0, 3);
+		double bc3Alpha = psnr(image.rgba, bc3Decoded, 3, 1);
+		double megapixels = double(image.width) * image.height / 1e6;
+		std::printf("bc: %s %dx%d, BC1 %.1f dB (%.1f Mpix/s), BC3 %.1f dB colour %.1f dB alpha (%.1f Mpix/s)\n",
+			image.name.c_str(), image.width, image.height, bc1Color, megapixels * 1000 / bc1Ms, bc3Color, bc3Alpha, megapixels * 1000 / bc3Ms);
+
+		// BC1 blocks must be opaque: the encoder never picks the 3-colour mode's transparent black
+		bool opaque = true;
+		for (size_t i = 3; i < bc1Decoded.size(); i += 4)
+			opaque &= bc1Decoded[i] == 255;
+		passed &= check(opaque, "BC1 output is opaque");
+		// BC3 shares the BC1 colour encoder
+		passed &= check(std::fabs(bc3Color - bc1Color) < 0.5, "BC3 colour matches BC1");
+		if (image.name != "noise") {
+			passed &= check(bc1Color >= BC_MIN_COLOR_PSNR, "BC1 colour quality");
+			passed &= check(bc3Alpha >= BC_MIN_ALPHA_PSNR, "BC3 alpha quality");
+		}
+	}
+	return passed ? 0 : 1;
+}
+
+namespace {
+	double srgbToLinear(uint8_t value) {
+		double c = value / 255.0;
+		return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+	}
+
+	// The 1x1 level of a box filtered chain is the mean of the image in linear light, whatever the sizes on the way
+	bool meanPreserved(const std::vector<TextureLevel>& levels) {
+		const TextureLevel& base = levels[0];
+		double mean[4] = { 0, 0, 0, 0 };
+		for (size_t i = 0; i < base.data.size(); i += 4) {
+			for (int c = 0; c < 3; c++)
+				mean[c] += srgbToLinear(base.data[i + c]);
+			mean[3] += base.data[i + 3] / 255.0;
+		}
+		const TextureLevel& last = levels.back();
+		double pixels = double(base.width) * base.height;
+		for (int c = 0; c < 4; c++) {
+			double value = c < 3 ? srgbToLinear(last.data[c]) : last.data[3] / 255.0;
+			// One 8-bit step of alpha, and at least one sRGB step of colour
+			if (std::fabs(value - mean[c] / pixels) > 1 / 255.0 + 1e-3)
+				return false;
+		}
+		return true;
+	}
+
+	TextureLevel randomLevel(int width, int height, std::mt19937& random) {
+		TextureLevel level = { width, height, std::vector<uint8_t>(size_t(4) * width * height) };
+		for (uint8_t& value : level.data)
+			value = uint8_t(random());
+		return level;
+	}
+}
+
+int benchMipChain(int argc, char** argv) {
+	bool passed = true;
+	std::mt19937 random(5);
+
+	// A white column next to two black ones: halving the odd width must not drop it
+	std::vector<TextureLevel> levels = { { 3, 1, { 0, 0, 0, 255, 0, 0, 0, 255, 255, 255, 255, 255 } } };
+	buildMipChain(levels);
+	passed &= check(levels.size() == 2 && meanPreserved(levels), "odd sizes keep their last column");
+
+	const int SIZES[][2] = { { 5, 3 }, { 67, 33 }, { 255, 129 }, { 256, 256 }, { 1, 7 }, { 640, 1 } };
+	for (const auto& size : SIZES) {
+		levels = { randomLevel(size[0], size[1], random) };
+		buildMipChain(levels);
+		bool sizes = true;
+		for (size_t i = 1; i < levels.size(); i++)
+			sizes &= levels[i].width == std::max(1, levels[i - 1].width / 2) && levels[i].height == std::max(1, levels[i - 1].height / 2)
+				&& levels[i].data.size() == size_t(4) * levels[i].width * levels[i].height;
+		sizes &= levels.back().width == 1 && levels.back().height == 1;
+		if (!sizes || !meanPreserved(levels)) {
+			std::printf("mip: %dx%d ", size[0], size[1]);
+			passed &= check(sizes, "level sizes halve down to 1x1");
+			passed &= check(meanPreserved(levels), "1x1 level is the linear mean of the image");
+		}
+	}
+
+	int width = argc > 0 ? std::atoi(argv[0]) : 2048;
+	int height = argc > 1 ? std::atoi(argv[1]) : width;
+	for (int odd = 0; odd < 2; odd++) {
+		TextureLevel base = randomLevel(width - odd, height - odd, random);
+		const int RUNS = 5;
+		double ms = 0;
+		for (int run = 0; run < RUNS; run++) {
+			levels = { base };
+			auto start = std::chrono::steady_clock::now();
+			buildMipChain(levels);
+			ms += elapsedMs(start);
+		}
+		ms /= RUNS;
+		std::printf("mip: %dx%d, %zu levels in %.1f ms, %.1f Mpix/s of source\n",
+			base.width, base.height, levels.size(), ms, double(base.width) * base.height / 1000 / ms);
+	}
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	uint16_t to565(const float* color) {
+		int r = std::min(31, std::max(0, int(color[0] * 31 / 255 + 0.5f)));
+		int g = std::min(63, std::max(0, int(color[1] * 63 / 255 + 0.5f)));
+		int b = std::min(31, std::max(0, int(color[2] * 31 / 255 + 0.5f)));
+		return uint16_t(r << 11 | g << 5 | b);
+	}
+
+	void from565(uint16_t color, int* rgb) {
+		int r = color >> 11 & 31, g = color >> 5 & 63, b = color & 31;
+		rgb[0] = r << 3 | r >> 2;
+		rgb[1] = g << 2 | g >> 4;
+		rgb[2] = b << 3 | b >> 2;
+	}
+
+	// Index of the nearest palette entry of each texel, returns the squared error
+	int selectColorIndices(const uint8_t* texels, uint16_t color0, uint16_t color1, uint8_t* indices) {
+		int palette[4][3];
+		from565(color0, palette[0]);
+		from565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		int error = 0;
+		for (int i = 0; i < 16; i++) {
+			const uint8_t* texel = texels + 4 * i;
+			int best = 0, bestDistance = 1 << 30;
+			for (int p = 0; p < 4; p++) {
+				int dr = texel[0] - palette[p][0], dg = texel[1] - palette[p][1], db = texel[2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices[i] = uint8_t(best);
+			error += bestDistance;
+		}
+		return error;
+	}
+
+	// Endpoints minimizing the error of the given indices (weights 1, 0, 2/3, 1/3 of color0)
+	bool fitEndpoints(const uint8_t* texels, const uint8_t* indices, float* color0, float* color1) {
+		static const float WEIGHTS[4] = { 1, 0, 2.f / 3, 1.f / 3 };
+		float aa = 0, ab = 0, bb = 0;
+		float ax[3] = {}, bx[3] = {};
+		for (int i = 0; i < 16; i++) {
+			float a = WEIGHTS[indices[i]], b = 1 - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 3; c++) {
+				ax[c] += a * texels[4 * i + c];
+				bx[c] += b * texels[4 * i + c];
+			}
+		}
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+		for (int c = 0; c < 3; c++) {
+			color0[c] = std::min(255.f, std::max(0.f, (ax[c] * bb - bx[c] * ab) / determinant));
+			color1[c] = std::min(255.f, std::max(0.f, (bx[c] * aa - ax[c] * ab) / determinant));
+		}
+		return true;
+	}
+
+	// Four-colour mode needs color0 > color1; swapping the endpoints swaps indices 0/1 and 2/3
+	void writeColorBlock(uint16_t color0, uint16_t color1, uint8_t* indices, uint8_t* block) {
+		if (color0 < color1) {
+			std::swap(color0, color1);
+			for (int i = 0; i < 16; i++)
+				indices[i] ^= 1;
+		} else if (color0 == color1) {
+			std::memset(indices, 0, 16);
+		}
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; i++)
+			bits |= uint32_t(indices[i]) << (2 * i);
+		block[0] = uint8_t(color0);
+		block[1] = uint8_t(color0 >> 8);
+		block[2] = uint8_t(color1);
+		block[3] = uint8_t(color1 >> 8);
+		for (int i = 0; i < 4; i++)
+			block[4 + i] = uint8_t(bits >> (8 * i));
+	}
+
+	void encodeAlphaBlock(const uint8_t* texels, uint8_t* block) {
+		int alpha0 = 0, alpha1 = 255;
+		for (int i = 0; i < 16; i++) {
+			alpha0 = std::max(alpha0, int(texels[4 * i + 3]));
+			alpha1 = std::min(alpha1, int(texels[4 * i + 3]));
+		}
+		block[0] = uint8_t(alpha0);
+		block[1] = uint8_t(alpha1);
+		uint64_t bits = 0;
+		if (alpha0 > alpha1) {
+			// Eight-value mode: a0, a1, then six steps from a0 to a1
+			int palette[8] = { alpha0, alpha1 };
+			for (int p = 1; p < 7; p++)
+				palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+			for (int i = 0; i < 16; i++) {
+				int alpha = texels[4 * i + 3];
+				int best = 0;
+				for (int p = 1; p < 8; p++)
+					if (std::abs(palette[p] - alpha) < std::abs(palette[best] - alpha))
+						best = p;
+				bits |= uint64_t(best) << (3 * i);
+			}
+		}
+		for (int i = 0; i < 6; i++)
+			block[2 + i] = uint8_t(bits >> (8 * i));
+	}
+
+	template <size_t BLOCK_SIZE, void (*ENCODE)(const uint8_t*, uint8_t*)>
+	std::vector<uint8_t> compress(const uint8_t* rgba, int width, int height) {
+		int blocksX = std::max(1, (width + 3) / 4), blocksY = std::max(1, (height + 3) / 4);
+		std::vector<uint8_t> blocks(BLOCK_SIZE * blocksX * blocksY);
+		uint8_t texels[64];
+		uint8_t* out = blocks.data();
+		for (int by = 0; by < blocksY; by++) {
+			for (int bx = 0; bx < blocksX; bx++) {
+				for (int y = 0; y < 4; y++) {
+					int sourceY = std::min(4 * by + y, height - 1);
+					for (int x = 0; x < 4; x++) {
+						int sourceX = std::min(4 * bx + x, width - 1);
+						std::memcpy(texels + 4 * (4 * y + x), rgba + 4 * (size_t(sourceY) * width + sourceX), 4);
+					}
+				}
+				ENCODE(texels, out);
+				out += BLOCK_SIZE;
+			}
+		}
+		return blocks;
+	}
+}
+
+void encodeBc1Block(const uint8_t* texels, uint8_t* block) {
+	float mean[3] = {};
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			mean[c] += texels[4 * i + c] / 16.f;
+	float covariance[6] = {};
+	for (int i = 0; i < 16; i++) {
+		float r = texels[4 * i] - mean[0], g = texels[4 * i + 1] - mean[1], b = texels[4 * i + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// Principal axis by power iteration, starting from the luminance direction
+	float axis[3] = { 0.299f, 0.587f, 0.114f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[3] = {
+			covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+			covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+			covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+		};
+		float length = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+		if (length < 1e-6f)
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	float minProjection = 1e30f, maxProjection = -1e30f;
+	int minTexel = 0, maxTexel = 0;
+	for (int i = 0; i < 16; i++) {
+		float projection = texels[4 * i] * axis[0] + texels[4 * i + 1] * axis[1] + texels[4 * i + 2] * axis[2];
+		if (projection < minProjection) {
+			minProjection = projection;
+			minTexel = i;
+		}
+		if (projection > maxProjection) {
+			maxProjection = projection;
+			maxTexel = i;
+		}
+	}
+
+	float color0[3], color1[3];
+	for (int c = 0; c < 3; c++) {
+		color0[c] = texels[4 * maxTexel + c];
+		color1[c] = texels[4 * minTexel + c];
+	}
+	uint16_t endpoint0 = to565(color0), endpoint1 = to565(color1);
+	uint8_t indices[16];
+	int error = selectColorIndices(texels, endpoint0, endpoint1, indices);
+
+	uint8_t refinedIndices[16];
+	if (fitEndpoints(texels, indices, color0, color1)) {
+		uint16_t refined0 = to565(color0), refined1 = to565(color1);
+		if (selectColorIndices(texels, refined0, refined1, refinedIndices) < error) {
+			endpoint0 = refined0;
+			endpoint1 = refined1;
+			std::memcpy(indices, refinedIndices, sizeof(indices));
+		}
+	}
+	writeColorBlock(endpoint0, endpoint1, indices, block);
+}
+
+void encodeBc3Block(const uint8_t* texels, uint8_t* block) {
+	encodeAlphaBlock(texels, block);
+	encodeBc1Block(texels, block + 8);
+}
+
+std::vector<uint8_t> compressBc1(const uint8_t* rgba, int width, int height) {
+	return compress<BC1_BLOCK_SIZE, encodeBc1Block>(rgba, width, height);
+}
+
+std::vector<uint8_t> compressBc3(const uint8_t* rgba, int width, int height) {
+	return compress<BC3_BLOCK_SIZE, encodeBc3Block>(rgba, width, height);
+}
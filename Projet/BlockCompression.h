@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// S3TC encoders for 4x4 blocks of RGBA8 texels, in row order.
+// BC1 (DXT1): 565 endpoints on the principal axis of the block colors, refined once by least squares, 2-bit indices.
+// BC3 (DXT5): the BC1 color block after an alpha block of 8-bit endpoints and 3-bit indices
+const size_t BC1_BLOCK_SIZE = 8;
+const size_t BC3_BLOCK_SIZE = 16;
+
+void encodeBc1Block(const uint8_t* texels, uint8_t* block);
+void encodeBc3Block(const uint8_t* texels, uint8_t* block);
+
+// Whole level, edge blocks repeat the last row and column. Returns the encoded blocks in row order
+std::vector<uint8_t> compressBc1(const uint8_t* rgba, int width, int height);
+std::vector<uint8_t> compressBc3(const uint8_t* rgba, int width, int height);
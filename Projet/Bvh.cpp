@@ -0,0 +1,277 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+const uint32_t Bvh::NONE;
+
+static const int SAH_BINS = 16;
+static const uint32_t MAX_LEAF_SIZE = 8;
+
+static float halfArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0));
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+void Bvh::build(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax) {
+	uint32_t count = uint32_t(boundsMin.size());
+	this->itemsMin = boundsMin;
+	this->itemsMax = boundsMax;
+	this->items.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		this->items[i] = i;
+	this->itemLeaves.assign(count, NONE);
+	this->nodes.clear();
+	this->parents.clear();
+	if (count == 0)
+		return;
+	this->nodes.reserve(2 * count);
+	this->parents.reserve(2 * count);
+	this->nodes.push_back({ glm::vec3(0), 0, glm::vec3(0), count });
+	this->parents.push_back(NONE);
+	this->subdivide(0);
+}
+
+void Bvh::fitLeaf(uint32_t node) {
+	BvhNode& leaf = this->nodes[node];
+	leaf.boundsMin = glm::vec3(FLT_MAX);
+	leaf.boundsMax = glm::vec3(-FLT_MAX);
+	for (uint32_t i = leaf.first; i < leaf.first + leaf.count; i++) {
+		leaf.boundsMin = glm::min(leaf.boundsMin, this->itemsMin[this->items[i]]);
+		leaf.boundsMax = glm::max(leaf.boundsMax, this->itemsMax[this->items[i]]);
+	}
+}
+
+void Bvh::fitInner(uint32_t node) {
+	BvhNode& inner = this->nodes[node];
+	const BvhNode& left = this->nodes[inner.first];
+	const BvhNode& right = this->nodes[inner.first + 1];
+	inner.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+	inner.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+}
+
+void Bvh::subdivide(uint32_t node) {
+	this->fitLeaf(node);
+	uint32_t first = this->nodes[node].first;
+	uint32_t count = this->nodes[node].count;
+	auto centroid = [this](uint32_t item) {
+		return (this->itemsMin[item] + this->itemsMax[item]) * 0.5f;
+	};
+
+	glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+	for (uint32_t i = first; i < first + count; i++) {
+		centroidMin = glm::min(centroidMin, centroid(this->items[i]));
+		centroidMax = glm::max(centroidMax, centroid(this->items[i]));
+	}
+
+	// Binned SAH: the cost of a split is the area of each side times its item count
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	if (count > 2) {
+		for (int axis = 0; axis < 3; axis++) {
+			float extent = centroidMax[axis] - centroidMin[axis];
+			if (extent <= 0)
+				continue;
+			glm::vec3 binsMin[SAH_BINS], binsMax[SAH_BINS];
+			uint32_t binsCount[SAH_BINS] = {};
+			for (int b = 0; b < SAH_BINS; b++) {
+				binsMin[b] = glm::vec3(FLT_MAX);
+				binsMax[b] = glm::vec3(-FLT_MAX);
+			}
+			float scale = SAH_BINS / extent;
+			for (uint32_t i = first; i < first + count; i++) {
+				uint32_t item = this->items[i];
+				int b = std::min(SAH_BINS - 1, int((centroid(item)[axis] - centroidMin[axis]) * scale));
+				binsCount[b]++;
+				binsMin[b] = glm::min(binsMin[b], this->itemsMin[item]);
+				binsMax[b] = glm::max(binsMax[b], this->itemsMax[item]);
+			}
+			// Left sides from a forward sweep, right sides from a backward one
+			float leftCost[SAH_BINS - 1];
+			glm::vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+			uint32_t sweepCount = 0;
+			for (int b = 0; b < SAH_BINS - 1; b++) {
+				sweepCount += binsCount[b];
+				sweepMin = glm::min(sweepMin, binsMin[b]);
+				sweepMax = glm::max(sweepMax, binsMax[b]);
+				leftCost[b] = sweepCount ? sweepCount * halfArea(sweepMin, sweepMax) : 0;
+			}
+			sweepMin = glm::vec3(FLT_MAX);
+			sweepMax = glm::vec3(-FLT_MAX);
+			sweepCount = 0;
+			for (int b = SAH_BINS - 1; b > 0; b--) {
+				sweepCount += binsCount[b];
+				sweepMin = glm::min(sweepMin, binsMin[b]);
+				sweepMax = glm::max(sweepMax, binsMax[b]);
+				float cost = leftCost[b - 1] + (sweepCount ? sweepCount * halfArea(sweepMin, sweepMax) : 0);
+				if (sweepCount && sweepCount < count && cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+	}
+
+	const BvhNode& current = this->nodes[node];
+	float leafCost = count * halfArea(current.boundsMin, current.boundsMax);
+	uint32_t leftCount = 0;
+	if (bestAxis >= 0 && (bestCost < leafCost || count > MAX_LEAF_SIZE)) {
+		float scale = SAH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+		uint32_t* begin = this->items.data() + first;
+		uint32_t* middle = std::partition(begin, begin + count, [&](uint32_t item) {
+			return std::min(SAH_BINS - 1, int((centroid(item)[bestAxis] - centroidMin[bestAxis]) * scale)) < bestSplit;
+		});
+		leftCount = uint32_t(middle - begin);
+	} else if (count > MAX_LEAF_SIZE) {
+		// Identical centroids: any split is as good as another
+		leftCount = count / 2;
+	}
+	if (leftCount == 0 || leftCount == count) {
+		for (uint32_t i = first; i < first + count; i++)
+			this->itemLeaves[this->items[i]] = node;
+		return;
+	}
+
+	uint32_t left = uint32_t(this->nodes.size());
+	this->nodes.push_back({ glm::vec3(0), first, glm::vec3(0), leftCount });
+	this->nodes.push_back({ glm::vec3(0), first + leftCount, glm::vec3(0), count - leftCount });
+	this->parents.push_back(node);
+	this->parents.push_back(node);
+	this->nodes[node].first = left;
+	this->nodes[node].count = 0;
+	this->subdivide(left);
+	this->subdivide(left + 1);
+}
+
+void Bvh::update(uint32_t item, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	this->itemsMin[item] = boundsMin;
+	this->itemsMax[item] = boundsMax;
+	uint32_t node = this->itemLeaves[item];
+	if (node == NONE)
+		return;
+	this->fitLeaf(node);
+	// Stops as soon as an ancestor keeps its bounds
+	for (node = this->parents[node]; node != NONE; node = this->parents[node]) {
+		BvhNode& inner = this->nodes[node];
+		glm::vec3 previousMin = inner.boundsMin, previousMax = inner.boundsMax;
+		this->fitInner(node);
+		if (inner.boundsMin == previousMin && inner.boundsMax == previousMax)
+			break;
+	}
+}
+
+void Bvh::refit() {
+	// Children are always stored after their parent
+	for (size_t i = this->nodes.size(); i-- > 0;) {
+		if (this->nodes[i].count > 0)
+			this->fitLeaf(uint32_t(i));
+		else
+			this->fitInner(uint32_t(i));
+	}
+}
+
+enum Containment { OUTSIDE, INTERSECTS, INSIDE };
+
+static Containment classify(const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+	Containment result = INSIDE;
+	for (const glm::vec4& plane : frustum.planes) {
+		float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+		float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+		if (distance + radius < 0)
+			return OUTSIDE;
+		if (distance - radius < 0)
+			result = INTERSECTS;
+	}
+	return result;
+}
+
+size_t Bvh::cullFrustum(const Frustum& frustum, uint8_t* visible, uint32_t& nodesVisited) const {
+	std::fill(visible, visible + this->items.size(), 0);
+	if (this->nodes.empty())
+		return 0;
+	size_t visibleCount = 0;
+	// (node, whether an ancestor is already fully inside)
+	std::vector<std::pair<uint32_t, bool>> stack;
+	stack.reserve(64);
+	stack.push_back({ 0, false });
+	while (!stack.empty()) {
+		const BvhNode& node = this->nodes[stack.back().first];
+		Containment containment = stack.back().second ? INSIDE : classify(frustum, node.boundsMin, node.boundsMax);
+		stack.pop_back();
+		nodesVisited++;
+		if (containment == OUTSIDE)
+			continue;
+		if (node.count > 0) {
+			// Only the items of a straddling leaf are tested on their own
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				uint32_t item = this->items[i];
+				if (containment == INSIDE || node.count == 1 || classify(frustum, this->itemsMin[item], this->itemsMax[item]) != OUTSIDE) {
+					visible[item] = 1;
+					visibleCount++;
+				}
+			}
+		} else {
+			stack.push_back({ node.first, containment == INSIDE });
+			stack.push_back({ node.first + 1, containment == INSIDE });
+		}
+	}
+	return visibleCount;
+}
+
+// Slab test, returns the entry distance or FLT_MAX when the box is missed or farther than `maxDistance`
+static float intersectBox(const glm::vec3& origin, const glm::vec3& inverseDirection, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float maxDistance) {
+	glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+	glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+	glm::vec3 near = glm::min(t0, t1), far = glm::max(t0, t1);
+	float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.f));
+	float exit = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+	return enter <= exit ? enter : FLT_MAX;
+}
+
+uint32_t Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, uint32_t& nodesVisited) const {
+	uint32_t hit = NONE;
+	distance = FLT_MAX;
+	if (this->nodes.empty())
+		return hit;
+	glm::vec3 inverseDirection = 1.f / direction;
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty()) {
+		const BvhNode& node = this->nodes[stack.back()];
+		stack.pop_back();
+		nodesVisited++;
+		if (intersectBox(origin, inverseDirection, node.boundsMin, node.boundsMax, distance) == FLT_MAX)
+			continue;
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				uint32_t item = this->items[i];
+				float itemDistance = intersectBox(origin, inverseDirection, this->itemsMin[item], this->itemsMax[item], distance);
+				if (itemDistance < distance) {
+					distance = itemDistance;
+					hit = item;
+				}
+			}
+			continue;
+		}
+		// Nearest child last, so that it is visited first and shrinks `distance` early
+		float left = intersectBox(origin, inverseDirection, this->nodes[node.first].boundsMin, this->nodes[node.first].boundsMax, distance);
+		float right = intersectBox(origin, inverseDirection, this->nodes[node.first + 1].boundsMin, this->nodes[node.first + 1].boundsMax, distance);
+		if (left < right) {
+			if (right != FLT_MAX)
+				stack.push_back(node.first + 1);
+			stack.push_back(node.first);
+		} else {
+			if (left != FLT_MAX)
+				stack.push_back(node.first);
+			if (right != FLT_MAX)
+				stack.push_back(node.first + 1);
+		}
+	}
+	return hit;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Culling.h"
+
+// Node of a Bvh: leaves (count > 0) cover items[first, first + count), inner nodes have their two children at
+// `first` and `first + 1`
+struct BvhNode {
+	glm::vec3 boundsMin;
+	uint32_t first;
+	glm::vec3 boundsMax;
+	uint32_t count;
+};
+
+// Bounding volume hierarchy over axis-aligned boxes, built with the binned surface area heuristic.
+// Moving items are handled by refitting the path from their leaf to the root, the topology is kept
+struct Bvh {
+	static const uint32_t NONE = 0xFFFFFFFF;
+
+	std::vector<BvhNode> nodes;
+	// Item indices, grouped by leaf
+	std::vector<uint32_t> items;
+	std::vector<glm::vec3> itemsMin;
+	std::vector<glm::vec3> itemsMax;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> itemLeaves;
+
+	void build(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax);
+	// Moves one item and enlarges or shrinks its ancestors as needed
+	void update(uint32_t item, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+	// Recomputes every node bottom-up, cheaper than updating most items one by one
+	void refit();
+
+	// Sets visible[item] to 1 for the items intersecting the frustum, without testing the subtrees that are fully
+	// inside or outside it. Returns the visible count, and adds the visited nodes to `nodesVisited`
+	size_t cullFrustum(const Frustum& frustum, uint8_t* visible, uint32_t& nodesVisited) const;
+	// Nearest item whose box the ray hits, or NONE. `direction` does not need to be normalized
+	uint32_t raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, uint32_t& nodesVisited) const;
+
+private:
+	void subdivide(uint32_t node);
+	void fitLeaf(uint32_t node);
+	void fitInner(uint32_t node);
+};
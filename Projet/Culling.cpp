@@ -0,0 +1,97 @@
+#include "Culling.h"
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_SSE2
+#endif
+
+Frustum Frustum::fromMatrix(const glm::mat4& matrix) {
+	// Gribb & Hartmann: every plane is the last row plus or minus another row
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = { matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i] };
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];
+	frustum.planes[1] = rows[3] - rows[0];
+	frustum.planes[2] = rows[3] + rows[1];
+	frustum.planes[3] = rows[3] - rows[1];
+	frustum.planes[4] = rows[3] + rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+	return frustum;
+}
+
+void CullingBoxes::resize(size_t count) {
+	for (std::vector<float>* component : { &this->centerX, &this->centerY, &this->centerZ, &this->extentX, &this->extentY, &this->extentZ })
+		component->resize(count);
+}
+
+void CullingBoxes::set(size_t index, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& transform) {
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+	// Arvo: the transformed extent along each axis sums the absolute contributions of the local axes
+	glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1));
+	glm::vec3 worldExtent = glm::abs(glm::vec3(transform[0])) * extent.x
+		+ glm::abs(glm::vec3(transform[1])) * extent.y
+		+ glm::abs(glm::vec3(transform[2])) * extent.z;
+	this->centerX[index] = worldCenter.x;
+	this->centerY[index] = worldCenter.y;
+	this->centerZ[index] = worldCenter.z;
+	this->extentX[index] = worldExtent.x;
+	this->extentY[index] = worldExtent.y;
+	this->extentZ[index] = worldExtent.z;
+}
+
+// A box is outside when, for some plane, even its corner furthest along the normal is behind it
+static bool boxVisible(const Frustum& frustum, const CullingBoxes& boxes, size_t i) {
+	for (const glm::vec4& plane : frustum.planes) {
+		float distance = plane.x * boxes.centerX[i] + plane.y * boxes.centerY[i] + plane.z * boxes.centerZ[i] + plane.w;
+		float radius = std::fabs(plane.x) * boxes.extentX[i] + std::fabs(plane.y) * boxes.extentY[i] + std::fabs(plane.z) * boxes.extentZ[i];
+		if (distance + radius < 0)
+			return false;
+	}
+	return true;
+}
+
+size_t cullBoxes(const Frustum& frustum, const CullingBoxes& boxes, uint8_t* visible) {
+	size_t count = boxes.size();
+	size_t visibleCount = 0;
+	size_t i = 0;
+#ifdef CULLING_SSE2
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+		absX[p] = _mm_and_ps(planeX[p], signMask);
+		absY[p] = _mm_and_ps(planeY[p], signMask);
+		absZ[p] = _mm_and_ps(planeZ[p], signMask);
+	}
+	for (; i + 4 <= count; i += 4) {
+		__m128 centerX = _mm_loadu_ps(&boxes.centerX[i]);
+		__m128 centerY = _mm_loadu_ps(&boxes.centerY[i]);
+		__m128 centerZ = _mm_loadu_ps(&boxes.centerZ[i]);
+		__m128 extentX = _mm_loadu_ps(&boxes.extentX[i]);
+		__m128 extentY = _mm_loadu_ps(&boxes.extentY[i]);
+		__m128 extentZ = _mm_loadu_ps(&boxes.extentZ[i]);
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], centerZ), planeW[p]));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], extentX), _mm_mul_ps(absY[p], extentY)), _mm_mul_ps(absZ[p], extentZ));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; lane++) {
+			visible[i + lane] = (mask >> lane & 1) ? 0 : 1;
+			visibleCount += visible[i + lane];
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		visible[i] = boxVisible(frustum, boxes, i) ? 1 : 0;
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Planes of a view frustum, as (normal, distance) with the normals pointing inside
+struct Frustum {
+	glm::vec4 planes[6];
+
+	// Extracts the planes of a projection * view (* model) matrix
+	static Frustum fromMatrix(const glm::mat4& matrix);
+};
+
+// World-space axis-aligned boxes stored as a structure of arrays, so that four of them are tested at once
+struct CullingBoxes {
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	void resize(size_t count);
+	inline size_t size() const {
+		return this->centerX.size();
+	}
+	// Stores the box bounding the local box [boundsMin, boundsMax] once transformed by `transform`
+	void set(size_t index, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& transform);
+};
+
+// Sets visible[i] to 1 for the boxes intersecting the frustum and 0 for the others, returns the visible count.
+// Conservative: boxes straddling two planes outside a corner are kept
+size_t cullBoxes(const Frustum& frustum, const CullingBoxes& boxes, uint8_t* visible);
@@ -0,0 +1,89 @@
+#include "DepthPyramid.h"
+#include <algorithm>
+#include <iostream>
+
+constexpr uint32_t U_SOURCE = GLShader::Key("source");
+constexpr uint32_t U_SOURCE_LEVEL = GLShader::Key("sourceLevel");
+
+bool DepthPyramid::initialize() {
+	if (!this->shader.LoadComputeShader("hiz.cs.glsl") || !this->shader.Create()) {
+		std::cerr << "DepthPyramid: cannot build hiz.cs.glsl" << std::endl;
+		this->shader.Destroy();
+		return false;
+	}
+	glGenQueries(TIMER_QUERIES, this->timerQueries);
+	return true;
+}
+
+void DepthPyramid::destroy() {
+	this->shader.Destroy();
+	glDeleteQueries(TIMER_QUERIES, this->timerQueries);
+	glDeleteTextures(1, &this->depthTexture);
+	glDeleteTextures(1, &this->texture);
+	this->depthTexture = this->texture = 0;
+	this->width = this->height = this->levels = 0;
+	this->valid = false;
+}
+
+void DepthPyramid::resize(GLsizei width, GLsizei height) {
+	glDeleteTextures(1, &this->depthTexture);
+	glDeleteTextures(1, &this->texture);
+	this->width = width;
+	this->height = height;
+	this->levels = 1;
+	while ((std::max(width, height) >> this->levels) > 0)
+		this->levels++;
+
+	// Immutable storage, so that both are complete without filtering parameters
+	glGenTextures(1, &this->depthTexture);
+	glBindTexture(GL_TEXTURE_2D, this->depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+	glGenTextures(1, &this->texture);
+	glBindTexture(GL_TEXTURE_2D, this->texture);
+	glTexStorage2D(GL_TEXTURE_2D, this->levels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+void DepthPyramid::build(GLState& state, const glm::mat4& viewProjection) {
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	GLsizei width = viewport[2], height = viewport[3];
+	if (width <= 0 || height <= 0)
+		return;
+	GLuint query = this->timerQueries[this->timerIndex];
+	if (this->timerPending[this->timerIndex]) {
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+		this->buildMs += nanoseconds / 1e6;
+		this->builds++;
+	}
+	glBeginQuery(GL_TIME_ELAPSED, query);
+
+	if (width != this->width || height != this->height) {
+		this->resize(width, height);
+		// The textures were bound behind the tracker's back
+		state.invalidate();
+	}
+	state.bindTexture(0, this->depthTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], width, height);
+
+	state.useProgram(this->shader.GetProgram());
+	this->shader.SetInt(U_SOURCE, 0);
+	for (GLsizei level = 0; level < this->levels; level++) {
+		// Level 0 copies the depth texture, the others reduce the level above them
+		state.bindTexture(0, level == 0 ? this->depthTexture : this->texture);
+		this->shader.SetInt(U_SOURCE_LEVEL, level - 1);
+		glBindImageTexture(0, this->texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		GLuint levelWidth = GLuint(std::max(width >> level, 1));
+		GLuint levelHeight = GLuint(std::max(height >> level, 1));
+		glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	this->timerPending[this->timerIndex] = true;
+	this->timerIndex = (this->timerIndex + 1) % TIMER_QUERIES;
+	this->viewProjection = viewProjection;
+	this->valid = true;
+}
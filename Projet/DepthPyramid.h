@@ -0,0 +1,44 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include "GLShader.h"
+#include "GLState.h"
+
+// Max-reduced mip chain of a depth buffer, built by hiz.cs.glsl: a box whose nearest depth is farther than the
+// texels it covers at the level where it spans at most 2x2 of them is hidden.
+// `viewProjection` is the matrix the depth was rendered with, boxes must be projected with it
+struct DepthPyramid {
+	static const int TIMER_QUERIES = 2;
+
+	GLShader shader;
+	// Copy of the depth buffer, level 0 of the pyramid is read from it
+	GLuint depthTexture = 0;
+	GLuint texture = 0;
+	GLsizei width = 0;
+	GLsizei height = 0;
+	GLsizei levels = 0;
+	bool valid = false;
+	glm::mat4 viewProjection = glm::mat4(1);
+
+	// GPU time of the builds, read back TIMER_QUERIES builds late so that it never stalls
+	GLuint timerQueries[TIMER_QUERIES] = {};
+	bool timerPending[TIMER_QUERIES] = {};
+	int timerIndex = 0;
+	double buildMs = 0;
+	uint32_t builds = 0;
+
+	bool initialize();
+	void destroy();
+
+	// Rebuilds from the depth buffer of the bound read framebuffer, over the current viewport
+	void build(GLState& state, const glm::mat4& viewProjection);
+	// Marks the pyramid unusable, for instance when the view is unrelated to the previous one
+	inline void invalidate() {
+		this->valid = false;
+	}
+
+private:
+	void resize(GLsizei width, GLsizei height);
+};
@@ -0,0 +1,41 @@
+#include "FileStamp.h"
+#include "MappedFile.h"
+#include <sys/stat.h>
+
+namespace {
+	uint64_t hashBytes(const uint8_t* data, size_t size) {
+		// FNV-1a
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= data[i];
+			hash *= 0x100000001b3ULL;
+		}
+		return hash;
+	}
+}
+
+bool stampFile(const std::string& file, FileStamp& stamp) {
+	struct stat info = {};
+	if (stat(file.c_str(), &info) != 0)
+		return false;
+	stamp.path = file;
+	stamp.size = uint64_t(info.st_size);
+	stamp.mtime = int64_t(info.st_mtime);
+	stamp.hash = 0;
+	return true;
+}
+
+bool hashFile(FileStamp& stamp) {
+	if (stamp.hash != 0)
+		return true;
+	// Empty files cannot be mapped
+	if (stamp.size == 0) {
+		stamp.hash = hashBytes(nullptr, 0);
+		return true;
+	}
+	MappedFile source;
+	if (!source.open(stamp.path))
+		return false;
+	stamp.hash = hashBytes(source.data, source.size);
+	return true;
+}
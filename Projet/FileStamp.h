@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Identifies the version of a file a cache was built from
+struct FileStamp {
+	std::string path;
+	uint64_t size = 0;
+	int64_t mtime = 0;
+	// Content hash, only computed when size and mtime are not enough to decide
+	uint64_t hash = 0;
+};
+
+// Size and mtime, without reading the file. Returns false when it does not exist
+bool stampFile(const std::string& file, FileStamp& stamp);
+// Fills stamp.hash, once
+bool hashFile(FileStamp& stamp);
@@ -0,0 +1,134 @@
+#include "GLState.h"
+
+void GLState::invalidate() {
+	this->program = UNKNOWN;
+	this->vao = UNKNOWN;
+	this->activeTexture = UNKNOWN;
+	for (GLuint& texture : this->textures)
+		texture = UNKNOWN;
+	this->blend = this->depthTest = this->cullFace = UNKNOWN;
+	this->blendSource = this->blendDestination = UNKNOWN;
+	this->arrayBuffer = this->drawIndirectBuffer = UNKNOWN;
+	for (int i = 0; i < RANGE_BINDINGS; i++) {
+		this->uniformRanges[i] = { UNKNOWN, -1, -1 };
+		this->storageRanges[i] = { UNKNOWN, -1, -1 };
+	}
+}
+
+bool GLState::changes(GLuint& shadow, GLuint value) {
+	if (shadow == value) {
+		this->filtered++;
+		return false;
+	}
+	shadow = value;
+	this->issued++;
+	return true;
+}
+
+bool GLState::useProgram(GLuint program) {
+	if (!this->changes(this->program, program))
+		return false;
+	glUseProgram(program);
+	return true;
+}
+
+bool GLState::bindVertexArray(GLuint vao) {
+	if (!this->changes(this->vao, vao))
+		return false;
+	glBindVertexArray(vao);
+	return true;
+}
+
+bool GLState::bindTexture(GLuint unit, GLuint texture, GLenum target) {
+	if (unit >= TEXTURE_UNITS) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		this->activeTexture = GL_TEXTURE0 + unit;
+		this->issued += 2;
+		return true;
+	}
+	if (!this->changes(this->textures[unit], texture))
+		return false;
+	if (this->changes(this->activeTexture, GL_TEXTURE0 + unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(target, texture);
+	return true;
+}
+
+void GLState::forgetTexture(GLuint texture) {
+	for (GLuint& shadow : this->textures)
+		if (shadow == texture)
+			shadow = 0;
+}
+
+void GLState::forgetBuffer(GLuint buffer) {
+	if (this->arrayBuffer == buffer)
+		this->arrayBuffer = 0;
+	if (this->drawIndirectBuffer == buffer)
+		this->drawIndirectBuffer = 0;
+	for (int i = 0; i < RANGE_BINDINGS; i++) {
+		if (this->uniformRanges[i].buffer == buffer)
+			this->uniformRanges[i] = { 0, 0, 0 };
+		if (this->storageRanges[i].buffer == buffer)
+			this->storageRanges[i] = { 0, 0, 0 };
+	}
+}
+
+void GLState::setEnabled(GLenum capability, bool enabled) {
+	GLuint* shadow = nullptr;
+	if (capability == GL_BLEND)
+		shadow = &this->blend;
+	else if (capability == GL_DEPTH_TEST)
+		shadow = &this->depthTest;
+	else if (capability == GL_CULL_FACE)
+		shadow = &this->cullFace;
+	if (shadow && !this->changes(*shadow, enabled ? 1 : 0))
+		return;
+	if (!shadow)
+		this->issued++;
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+void GLState::blendFunc(GLenum source, GLenum destination) {
+	if (this->blendSource == source && this->blendDestination == destination) {
+		this->filtered++;
+		return;
+	}
+	this->blendSource = source;
+	this->blendDestination = destination;
+	this->issued++;
+	glBlendFunc(source, destination);
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer) {
+	GLuint* shadow = nullptr;
+	if (target == GL_ARRAY_BUFFER)
+		shadow = &this->arrayBuffer;
+	else if (target == GL_DRAW_INDIRECT_BUFFER)
+		shadow = &this->drawIndirectBuffer;
+	if (shadow && !this->changes(*shadow, buffer))
+		return;
+	if (!shadow)
+		this->issued++;
+	glBindBuffer(target, buffer);
+}
+
+void GLState::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	RangeBinding* shadow = nullptr;
+	if (index < RANGE_BINDINGS && target == GL_UNIFORM_BUFFER)
+		shadow = &this->uniformRanges[index];
+	else if (index < RANGE_BINDINGS && target == GL_SHADER_STORAGE_BUFFER)
+		shadow = &this->storageRanges[index];
+	if (shadow) {
+		if (shadow->buffer == buffer && shadow->offset == offset && shadow->size == size) {
+			this->filtered++;
+			return;
+		}
+		*shadow = { buffer, offset, size };
+	}
+	this->issued++;
+	glBindBufferRange(target, index, buffer, offset, size);
+}
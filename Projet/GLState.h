@@ -0,0 +1,70 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+
+// Shadow copy of the GL state changed while drawing: calls that would not change it are dropped.
+// Everything starts unknown, and must be invalidated again after GL calls made behind the tracker's back
+struct GLState {
+	static const int TEXTURE_UNITS = 8;
+	static const int RANGE_BINDINGS = 8;
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	struct RangeBinding {
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	GLuint program = UNKNOWN;
+	GLuint vao = UNKNOWN;
+	GLenum activeTexture = UNKNOWN;
+	GLuint textures[TEXTURE_UNITS];
+	// Capabilities: 0 disabled, 1 enabled, UNKNOWN
+	GLuint blend = UNKNOWN;
+	GLuint depthTest = UNKNOWN;
+	GLuint cullFace = UNKNOWN;
+	GLenum blendSource = UNKNOWN;
+	GLenum blendDestination = UNKNOWN;
+	GLuint arrayBuffer = UNKNOWN;
+	GLuint drawIndirectBuffer = UNKNOWN;
+	RangeBinding uniformRanges[RANGE_BINDINGS];
+	RangeBinding storageRanges[RANGE_BINDINGS];
+
+	// Calls forwarded to GL and calls dropped, since resetStats
+	uint32_t issued = 0;
+	uint32_t filtered = 0;
+
+	GLState() {
+		this->invalidate();
+	}
+
+	void invalidate();
+	inline void resetStats() {
+		this->issued = 0;
+		this->filtered = 0;
+	}
+
+	// These return true when the call was issued
+	bool useProgram(GLuint program);
+	bool bindVertexArray(GLuint vao);
+	// Selects `unit` only if the texture bound there changes. Texture names are unique across targets, so one
+	// shadow per unit is enough even when a unit is used with several targets
+	bool bindTexture(GLuint unit, GLuint texture, GLenum target = GL_TEXTURE_2D);
+	// GL unbinds a texture when it is deleted: its name must not stay shadowed, or a new texture reusing it
+	// would never be bound
+	void forgetTexture(GLuint texture);
+	// Same for a deleted buffer, in the targets and ranges shadowed
+	void forgetBuffer(GLuint buffer);
+	void setEnabled(GLenum capability, bool enabled);
+	void blendFunc(GLenum source, GLenum destination);
+	// Shadowed for GL_ARRAY_BUFFER and GL_DRAW_INDIRECT_BUFFER, forwarded for other targets
+	void bindBuffer(GLenum target, GLuint buffer);
+	// Shadowed for the first RANGE_BINDINGS uniform and shader storage bindings.
+	// The generic binding point it also changes is not tracked
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+private:
+	// Updates `shadow` and returns true when the call must be issued
+	bool changes(GLuint& shadow, GLuint value);
+};
@@ -0,0 +1,104 @@
+#include "GeometryArena.h"
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+// Moves `buffer` to a bigger one, keeping its first `usedBytes`
+static void growBuffer(GLuint& buffer, GLsizeiptr usedBytes, GLsizeiptr newBytes) {
+	GLuint grown;
+	glGenBuffers(1, &grown);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+	glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+	if (buffer && usedBytes > 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &buffer);
+	buffer = grown;
+}
+
+void GeometryArena::initialize(GLState& state, GLsizeiptr vertexCapacity, GLsizeiptr indexCapacity) {
+	this->state = &state;
+	this->vertexCapacity = std::max<GLsizeiptr>(vertexCapacity, 1);
+	this->indexCapacity = std::max<GLsizeiptr>(indexCapacity, 1);
+	growBuffer(this->vertexBuffer, 0, this->vertexCapacity * sizeof(Vertex3));
+	growBuffer(this->indexBuffer, 0, this->indexCapacity * sizeof(uint32_t));
+
+	glGenVertexArrays(1, &this->vao);
+	this->state->bindVertexArray(this->vao);
+	glEnableVertexAttribArray(POSITION_LOCATION);
+	glEnableVertexAttribArray(NORMAL_LOCATION);
+	glEnableVertexAttribArray(TEX_COORDS_LOCATION);
+	glVertexAttribFormat(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex3, position));
+	glVertexAttribFormat(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex3, normal));
+	glVertexAttribFormat(TEX_COORDS_LOCATION, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex3, texCoords));
+	glVertexAttribBinding(POSITION_LOCATION, 0);
+	glVertexAttribBinding(NORMAL_LOCATION, 0);
+	glVertexAttribBinding(TEX_COORDS_LOCATION, 0);
+	glBindVertexBuffer(0, this->vertexBuffer, 0, sizeof(Vertex3));
+	glEnableVertexAttribArray(DRAW_ID_LOCATION);
+	glVertexAttribIFormat(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, 0);
+	glVertexAttribBinding(DRAW_ID_LOCATION, 1);
+	glVertexBindingDivisor(1, 1);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+	this->state->bindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::destroy() {
+	glDeleteVertexArrays(1, &this->vao);
+	glDeleteBuffers(1, &this->vertexBuffer);
+	glDeleteBuffers(1, &this->indexBuffer);
+	glDeleteBuffers(1, &this->drawIdBuffer);
+	this->vao = this->vertexBuffer = this->indexBuffer = this->drawIdBuffer = 0;
+}
+
+void GeometryArena::add(const Mesh& mesh, GLint& baseVertex, GLuint& firstIndex) {
+	GLsizeiptr vertices = GLsizeiptr(mesh.vertices.size());
+	GLsizeiptr indices = GLsizeiptr(mesh.indices.size());
+	if (this->vertexCount + vertices > this->vertexCapacity) {
+		GLsizeiptr capacity = std::max(this->vertexCapacity * 2, this->vertexCount + vertices);
+		growBuffer(this->vertexBuffer, this->vertexCount * sizeof(Vertex3), capacity * sizeof(Vertex3));
+		this->vertexCapacity = capacity;
+		this->state->bindVertexArray(this->vao);
+		glBindVertexBuffer(0, this->vertexBuffer, 0, sizeof(Vertex3));
+		this->state->bindVertexArray(0);
+	}
+	if (this->indexCount + indices > this->indexCapacity) {
+		GLsizeiptr capacity = std::max(this->indexCapacity * 2, this->indexCount + indices);
+		growBuffer(this->indexBuffer, this->indexCount * sizeof(uint32_t), capacity * sizeof(uint32_t));
+		this->indexCapacity = capacity;
+		this->state->bindVertexArray(this->vao);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+		this->state->bindVertexArray(0);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, this->vertexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, this->vertexCount * sizeof(Vertex3), vertices * sizeof(Vertex3), mesh.vertices.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, this->indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, this->indexCount * sizeof(uint32_t), indices * sizeof(uint32_t), mesh.indices.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	baseVertex = GLint(this->vertexCount);
+	firstIndex = GLuint(this->indexCount);
+	this->vertexCount += vertices;
+	this->indexCount += indices;
+}
+
+void GeometryArena::reserveDraws(GLuint count) {
+	if (count <= this->drawCapacity)
+		return;
+	std::vector<GLuint> drawIds(count);
+	std::iota(drawIds.begin(), drawIds.end(), 0);
+	glDeleteBuffers(1, &this->drawIdBuffer);
+	glGenBuffers(1, &this->drawIdBuffer);
+	this->state->bindBuffer(GL_ARRAY_BUFFER, this->drawIdBuffer);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(count * sizeof(GLuint)), drawIds.data(), GL_STATIC_DRAW);
+	this->state->bindBuffer(GL_ARRAY_BUFFER, 0);
+	this->state->bindVertexArray(this->vao);
+	glBindVertexBuffer(1, this->drawIdBuffer, 0, sizeof(GLuint));
+	this->state->bindVertexArray(0);
+	this->drawCapacity = count;
+}
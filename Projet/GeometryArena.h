@@ -0,0 +1,46 @@
+#pragma once
+
+#include <GL/glew.h>
+#include "GLState.h"
+#include "Mesh.h"
+
+// Indirect draw record read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Vertices and 32-bit indices of every static mesh, suballocated from two shared buffers behind a single VAO.
+// Attribute locations are fixed (see the *_indirect shaders) so that any program can draw from it.
+// The `drawId` attribute is instanced and reads 0, 1, 2... from a static buffer: with one instance per
+// command, it evaluates to the command's baseInstance, which indexes the per-draw data
+struct GeometryArena {
+	static const GLuint POSITION_LOCATION = 0;
+	static const GLuint NORMAL_LOCATION = 1;
+	static const GLuint TEX_COORDS_LOCATION = 2;
+	static const GLuint DRAW_ID_LOCATION = 3;
+
+	GLuint vertexBuffer = 0;
+	GLuint indexBuffer = 0;
+	GLuint drawIdBuffer = 0;
+	GLuint vao = 0;
+	// In vertices, indices and draws
+	GLsizeiptr vertexCapacity = 0;
+	GLsizeiptr vertexCount = 0;
+	GLsizeiptr indexCapacity = 0;
+	GLsizeiptr indexCount = 0;
+	GLuint drawCapacity = 0;
+	// The VAO and GL_ARRAY_BUFFER are bound through it, so that growing the arena while drawing keeps it accurate
+	GLState* state = nullptr;
+
+	void initialize(GLState& state, GLsizeiptr vertexCapacity, GLsizeiptr indexCapacity);
+	void destroy();
+
+	// Appends the mesh, growing the buffers if needed. Its indices stay relative to `baseVertex`
+	void add(const Mesh& mesh, GLint& baseVertex, GLuint& firstIndex);
+	// Makes drawId valid for `count` draws per submission
+	void reserveDraws(GLuint count);
+};
@@ -0,0 +1,105 @@
+#include "MappedFile.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+	this->close();
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	this->fileHandle = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		this->close();
+		return false;
+	}
+	this->size = size_t(size.QuadPart);
+
+	this->mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!this->mappingHandle) {
+		this->close();
+		return false;
+	}
+	this->data = static_cast<const uint8_t*>(MapViewOfFile(this->mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (!this->data) {
+		this->close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close() {
+	if (this->data)
+		UnmapViewOfFile(this->data);
+	if (this->mappingHandle)
+		CloseHandle(this->mappingHandle);
+	if (this->fileHandle)
+		CloseHandle(this->fileHandle);
+	this->data = nullptr;
+	this->size = 0;
+	this->mappingHandle = nullptr;
+	this->fileHandle = nullptr;
+}
+
+void MappedFile::dropPages(size_t size) {
+	// Unlocking pages that are not locked removes them from the working set
+	if (this->data && size > 0)
+		VirtualUnlock(const_cast<uint8_t*>(this->data), std::min(size, this->size));
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+	this->close();
+	this->fd = ::open(path.c_str(), O_RDONLY);
+	if (this->fd < 0)
+		return false;
+
+	struct stat info = {};
+	if (fstat(this->fd, &info) != 0 || info.st_size == 0) {
+		this->close();
+		return false;
+	}
+	this->size = size_t(info.st_size);
+
+	void* mapping = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, this->fd, 0);
+	if (mapping == MAP_FAILED) {
+		this->close();
+		return false;
+	}
+	this->data = static_cast<const uint8_t*>(mapping);
+	return true;
+}
+
+void MappedFile::close() {
+	if (this->data)
+		munmap(const_cast<uint8_t*>(this->data), this->size);
+	if (this->fd >= 0)
+		::close(this->fd);
+	this->data = nullptr;
+	this->size = 0;
+	this->fd = -1;
+}
+
+void MappedFile::dropPages(size_t size) {
+	// Whole pages only: the one holding byte `size` may still be read
+	auto pageSize = size_t(sysconf(_SC_PAGESIZE));
+	size = std::min(size, this->size) / pageSize * pageSize;
+	if (this->data && size > 0)
+		madvise(const_cast<uint8_t*>(this->data), size, MADV_DONTNEED);
+}
+
+#endif
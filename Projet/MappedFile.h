@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file
+struct MappedFile {
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#else
+	int fd = -1;
+#endif
+
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() {
+		this->close();
+	}
+
+	bool open(const std::string& path);
+	void close();
+	// Drops the pages of the first `size` bytes from the resident memory once they are read; they stay mapped and are
+	// read from the file again if touched
+	void dropPages(size_t size);
+};
@@ -0,0 +1,280 @@
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+namespace {
+	tinyobj::material_t defaultMaterial() {
+		tinyobj::material_t material = {};
+		material.name = "default";
+		for (int i = 0; i < 3; i++) {
+			material.ambient[i] = 1;
+			material.diffuse[i] = 1;
+			material.specular[i] = 0;
+		}
+		material.shininess = 1;
+		material.dissolve = 1;
+		return material;
+	}
+
+	// Remembers the material libraries the OBJ file pulls in, so that caches can watch them
+	class RecordingMaterialReader : public tinyobj::MaterialReader {
+	public:
+		RecordingMaterialReader(const std::string& searchPath, std::vector<std::string>& files)
+			: reader(searchPath), searchPath(searchPath), files(files) {}
+
+		bool operator()(const std::string& matId, std::vector<tinyobj::material_t>* materials,
+				std::map<std::string, int>* matMap, std::string* warn, std::string* err) override {
+			// Same resolution as MaterialFileReader with a single search path
+			std::string file = this->searchPath.empty() ? matId : this->searchPath + "/" + matId;
+			if (std::find(this->files.begin(), this->files.end(), file) == this->files.end())
+				this->files.push_back(file);
+			return this->reader(matId, materials, matMap, warn, err);
+		}
+
+	private:
+		tinyobj::MaterialFileReader reader;
+		std::string searchPath;
+		std::vector<std::string>& files;
+	};
+
+	// End of a weld chain
+	const uint32_t NO_VERTEX = UINT32_MAX;
+
+	// Welds face corners as the parser hands them over. The welded vertices sharing a position are chained from that
+	// position, so that a corner only walks the few (normal, texCoord) pairs already met with its position; this costs
+	// 4 bytes per position and 12 per welded vertex, a fraction of a hash map
+	struct StreamingWeld {
+		struct Link {
+			uint32_t next;
+			int normal;
+			int texCoord;
+		};
+
+		Mesh& mesh;
+		MappedFile& file;
+		// Indices bucketed by material id, concatenated into submeshes once every face is read
+		std::map<int, std::vector<uint32_t>> buckets;
+		std::vector<uint32_t> firstVertex;
+		std::vector<Link> links;
+		bool outOfBounds = false;
+
+		StreamingWeld(Mesh& mesh, MappedFile& file) : mesh(mesh), file(file) {}
+
+		static void addShape(void* self, const tinyobj::attrib_t& attrib, tinyobj::shape_t* shape) {
+			static_cast<StreamingWeld*>(self)->add(attrib, shape->mesh);
+		}
+
+		// Read windows of the file are not needed anymore, nor their pages
+		static void consumed(void* self, size_t size) {
+			static_cast<StreamingWeld*>(self)->file.dropPages(size);
+		}
+
+		void add(const tinyobj::attrib_t& attrib, const tinyobj::mesh_t& shapeMesh) {
+			size_t positionCount = attrib.vertices.size() / 3;
+			int normalCount = int(attrib.normals.size() / 3);
+			int texCoordCount = int(attrib.texcoords.size() / 2);
+			this->firstVertex.resize(positionCount, NO_VERTEX);
+			this->mesh.cornerCount += shapeMesh.indices.size();
+
+			size_t corner = 0;
+			for (size_t f = 0; f < shapeMesh.num_face_vertices.size(); f++) {
+				int materialId = shapeMesh.material_ids[f];
+				if (materialId >= int(this->mesh.materials.size()))
+					materialId = -1;
+				std::vector<uint32_t>& bucket = this->buckets[materialId];
+
+				for (size_t end = corner + shapeMesh.num_face_vertices[f]; corner < end; corner++) {
+					tinyobj::index_t idx = shapeMesh.indices[corner];
+					// Faces only see what precedes them: forward references are rejected rather than read out of bounds
+					if (idx.vertex_index < 0 || size_t(idx.vertex_index) >= positionCount || idx.normal_index >= normalCount
+							|| idx.texcoord_index >= texCoordCount) {
+						this->outOfBounds = true;
+						return;
+					}
+
+					uint32_t& first = this->firstVertex[size_t(idx.vertex_index)];
+					uint32_t index = first;
+					while (index != NO_VERTEX && (this->links[index].normal != idx.normal_index || this->links[index].texCoord != idx.texcoord_index))
+						index = this->links[index].next;
+					if (index == NO_VERTEX) {
+						index = uint32_t(this->mesh.vertices.size());
+						this->links.push_back({ first, idx.normal_index, idx.texcoord_index });
+						first = index;
+						this->mesh.vertices.push_back(makeVertex(attrib, idx));
+					}
+					bucket.push_back(index);
+				}
+			}
+		}
+
+		static Vertex3 makeVertex(const tinyobj::attrib_t& attrib, tinyobj::index_t idx) {
+			Vertex3 vertex = {};
+
+			// Vertex position
+			vertex.position.x = attrib.vertices[3 * size_t(idx.vertex_index) + 0];
+			vertex.position.y = attrib.vertices[3 * size_t(idx.vertex_index) + 2];
+			vertex.position.z = -attrib.vertices[3 * size_t(idx.vertex_index) + 1];
+
+			// Check if `normal_index` is zero or positive. negative = no normal data
+			if (idx.normal_index >= 0) {
+				vertex.normal.x = attrib.normals[3 * size_t(idx.normal_index) + 0];
+				vertex.normal.y = attrib.normals[3 * size_t(idx.normal_index) + 2];
+				vertex.normal.z = -attrib.normals[3 * size_t(idx.normal_index) + 1];
+			}
+
+			// Check if `texcoord_index` is zero or positive. negative = no texcoord data
+			if (idx.texcoord_index >= 0) {
+				vertex.texCoords.x = attrib.texcoords[2 * size_t(idx.texcoord_index) + 0];
+				vertex.texCoords.y = attrib.texcoords[2 * size_t(idx.texcoord_index) + 1];
+			}
+			return vertex;
+		}
+	};
+}
+
+bool Mesh::load(const std::string& objFile) {
+	MappedFile file;
+	if (!file.open(objFile)) {
+		std::cerr << "TinyObjReader(" << objFile << "): Cannot open file" << std::endl;
+		return false;
+	}
+
+	// Materials are searched next to the OBJ file, like ObjReader::ParseFromFile does
+	std::string mtlSearchPath;
+	size_t separator = objFile.find_last_of("/\\");
+	if (separator != std::string::npos)
+		mtlSearchPath = objFile.substr(0, separator);
+	this->materialFiles.clear();
+	RecordingMaterialReader materialReader(mtlSearchPath, this->materialFiles);
+
+	// Faces are welded window by window as they are parsed: beyond a bounded window, only the attributes, the weld
+	// chains and the welded mesh itself grow with the file
+	this->materials.clear();
+	this->vertices.clear();
+	this->cornerCount = 0;
+	StreamingWeld weld(*this, file);
+	tinyobj::stream_callback_t callback;
+	callback.shape_cb = StreamingWeld::addShape;
+	callback.consumed_cb = StreamingWeld::consumed;
+	tinyobj::attrib_t attrib;
+	std::string warning, error;
+	bool parsed = tinyobj::LoadObjStreamed(&attrib, &this->materials, callback, &weld, &warning, &error,
+		reinterpret_cast<const char*>(file.data), file.size, &materialReader, true, false);
+
+	if (!parsed || weld.outOfBounds) {
+		if (weld.outOfBounds)
+			std::cerr << "TinyObjReader(" << objFile << "): face index out of bounds" << std::endl;
+		else if (!error.empty())
+			std::cerr << "TinyObjReader(" << objFile << "): " << error;
+		return false;
+	}
+
+	if (!warning.empty()) {
+		std::cout << "TinyObjReader(" << objFile << "): " << warning;
+	}
+
+	// Only the welded arrays are left alive past this point
+	attrib = tinyobj::attrib_t();
+	std::vector<uint32_t>().swap(weld.firstVertex);
+	std::vector<StreamingWeld::Link>().swap(weld.links);
+	this->vertices.shrink_to_fit();
+
+	// One submesh per material bucket, each bucket released once copied
+	this->submeshes.clear();
+	this->indices.clear();
+	for (auto& bucket : weld.buckets) {
+		int materialId = bucket.first;
+		// Faces without a usable material get a plain white one
+		if (materialId < 0) {
+			materialId = int(this->materials.size());
+			this->materials.push_back(defaultMaterial());
+		}
+		this->submeshes.push_back({ materialId, uint32_t(this->indices.size()), uint32_t(bucket.second.size()) });
+		if (weld.buckets.size() == 1) {
+			this->indices.swap(bucket.second);
+		} else {
+			this->indices.reserve(this->cornerCount);
+			this->indices.insert(this->indices.end(), bucket.second.begin(), bucket.second.end());
+		}
+		std::vector<uint32_t>().swap(bucket.second);
+	}
+	this->indices.shrink_to_fit();
+
+	this->computeBounds();
+
+	std::cout << "Mesh(" << objFile << "): " << this->cornerCount << " corners welded into " << this->vertices.size()
+		<< " vertices (" << (this->hasShortIndices() ? 16 : 32) << "-bit indices), " << this->submeshes.size() << " submeshes" << std::endl;
+	return true;
+}
+
+bool Mesh::loadCached(const std::string& objFile, bool optimized) {
+	auto start = std::chrono::steady_clock::now();
+	std::string cacheFile = objFile + MESH_CACHE_EXTENSION;
+
+	FileStamp stamp;
+	if (!stampFile(objFile, stamp)) {
+		std::cerr << "Mesh(" << objFile << "): cannot read source file" << std::endl;
+		return false;
+	}
+
+	bool fromCache = readMeshCache(cacheFile, stamp, optimized, *this);
+	if (!fromCache) {
+		if (!this->load(objFile))
+			return false;
+		if (optimized)
+			this->optimize();
+		if (!writeMeshCache(cacheFile, stamp, optimized, *this))
+			std::cerr << "Mesh(" << objFile << "): cannot write cache " << cacheFile << std::endl;
+	}
+
+	auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Mesh(" << objFile << "): " << (fromCache ? "loaded from cache" : "parsed") << " in " << elapsed << " ms" << std::endl;
+	return true;
+}
+
+void Mesh::optimize() {
+	VertexCacheStats before = analyzeVertexCache(this->indices.data(), this->indices.size(), this->vertices.size());
+	// Triangles only move inside their submesh, so that material ranges stay contiguous
+	for (const Submesh& submesh : this->submeshes) {
+		uint32_t* first = this->indices.data() + submesh.firstIndex;
+		optimizeVertexCache(first, submesh.indexCount, this->vertices.size());
+		optimizeOverdraw(first, submesh.indexCount, this->vertices);
+	}
+	optimizeVertexFetch(this->vertices, this->indices);
+	VertexCacheStats after = analyzeVertexCache(this->indices.data(), this->indices.size(), this->vertices.size());
+
+	std::cout << "Mesh optimized: ACMR " << before.acmr << " -> " << after.acmr
+		<< ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+void Mesh::computeBounds() {
+	if (this->vertices.empty()) {
+		this->boundsMin = this->boundsMax = { 0, 0, 0 };
+		return;
+	}
+	this->boundsMin = this->boundsMax = this->vertices[0].position;
+	for (const Vertex3& vertex : this->vertices) {
+		this->boundsMin = glm::min(this->boundsMin, vertex.position);
+		this->boundsMax = glm::max(this->boundsMax, vertex.position);
+	}
+}
+
+std::vector<uint8_t> Mesh::packIndices() const {
+	std::vector<uint8_t> packed;
+	if (this->hasShortIndices()) {
+		packed.resize(sizeof(uint16_t) * this->indices.size());
+		auto* out = reinterpret_cast<uint16_t*>(packed.data());
+		for (size_t i = 0; i < this->indices.size(); i++)
+			out[i] = uint16_t(this->indices[i]);
+	} else {
+		packed.resize(sizeof(uint32_t) * this->indices.size());
+		std::memcpy(packed.data(), this->indices.data(), packed.size());
+	}
+	return packed;
+}
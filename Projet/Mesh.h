@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tiny_obj_loader.h"
+
+struct Vertex3 {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 texCoords;
+};
+
+// Contiguous range of indices drawn with the same material
+struct Submesh {
+	int materialId;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+// CPU side copy of an OBJ file, welded into unique vertices and real indices
+struct Mesh {
+	std::vector<Vertex3> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<tinyobj::material_t> materials;
+	// Material libraries the OBJ file pulled in, found or not, so that caches can watch them
+	std::vector<std::string> materialFiles;
+	// Faces bucketed by material, every material id is valid in `materials`
+	std::vector<Submesh> submeshes;
+	size_t cornerCount = 0;
+	glm::vec3 boundsMin = { 0, 0, 0 };
+	glm::vec3 boundsMax = { 0, 0, 0 };
+
+	// The file is parsed and welded window by window: peak memory is the welded mesh itself, its attributes and weld
+	// chains, plus a bounded parse window
+	bool load(const std::string& objFile);
+	// Loads from the binary cache next to the OBJ file when it is up to date, and writes it otherwise
+	bool loadCached(const std::string& objFile, bool optimized);
+	// Vertex cache, overdraw and vertex fetch optimization, run once after loading
+	void optimize();
+
+	inline bool hasShortIndices() const {
+		return this->vertices.size() <= 0xFFFF;
+	}
+
+	void computeBounds();
+
+	// Index data ready to be uploaded, narrowed to 16 bits when the mesh fits
+	std::vector<uint8_t> packIndices() const;
+};
@@ -0,0 +1,244 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace {
+	const char MESH_CACHE_MAGIC[4] = { 'O', 'B', 'J', 'C' };
+	const uint32_t MESH_CACHE_FLAG_OPTIMIZED = 1;
+
+	// Size recorded for a material library that did not exist when the cache was written
+	const uint64_t MESH_CACHE_MISSING_FILE = std::numeric_limits<uint64_t>::max();
+
+	// Layout of a cache file: header, material library stamps, vertex stream, index stream (32 bits), submesh table,
+	// material table
+	struct MeshCacheHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexSize;
+		uint32_t flags;
+		uint64_t sourceSize;
+		int64_t sourceMtime;
+		uint64_t sourceHash;
+		uint64_t vertexCount;
+		uint64_t indexCount;
+		uint64_t cornerCount;
+		uint32_t materialCount;
+		uint32_t submeshCount;
+		uint32_t materialFileCount;
+		float boundsMin[3];
+		float boundsMax[3];
+	};
+
+	// Smallest encoding of a material and of a material library stamp, to reject counts the file cannot hold
+	const size_t MATERIAL_MIN_SIZE = 2 * sizeof(uint32_t) + 11 * sizeof(float);
+	const size_t MATERIAL_FILE_MIN_SIZE = sizeof(uint32_t) + 3 * sizeof(uint64_t);
+
+	struct CacheReader {
+		const uint8_t* cursor;
+		const uint8_t* end;
+
+		size_t remaining() const {
+			return size_t(this->end - this->cursor);
+		}
+
+		bool read(void* out, size_t size) {
+			if (size_t(this->end - this->cursor) < size)
+				return false;
+			std::memcpy(out, this->cursor, size);
+			this->cursor += size;
+			return true;
+		}
+
+		bool readString(std::string& out) {
+			uint32_t length;
+			if (!this->read(&length, sizeof(length)) || size_t(this->end - this->cursor) < length)
+				return false;
+			out.assign(reinterpret_cast<const char*>(this->cursor), length);
+			this->cursor += length;
+			return true;
+		}
+	};
+
+	void writeString(std::ofstream& out, const std::string& value) {
+		auto length = uint32_t(value.size());
+		out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		out.write(value.data(), std::streamsize(length));
+	}
+
+	// Compares a recorded stamp with the file on disk. A file touched but unchanged still matches, and gets its
+	// new mtime recorded in `touchedMtime` so that the cache can be updated and skip the hash next time
+	bool sourceUnchanged(FileStamp& current, bool exists, uint64_t size, int64_t mtime, uint64_t hash, bool& touched) {
+		if (size == MESH_CACHE_MISSING_FILE || !exists)
+			return size == MESH_CACHE_MISSING_FILE && !exists;
+		if (size != current.size)
+			return false;
+		if (mtime == current.mtime)
+			return true;
+		touched = hashFile(current) && hash == current.hash;
+		return touched;
+	}
+}
+
+bool readMeshCache(const std::string& cacheFile, FileStamp& stamp, bool optimized, Mesh& mesh) {
+	MappedFile file;
+	if (!file.open(cacheFile))
+		return false;
+
+	CacheReader reader = { file.data, file.data + file.size };
+	MeshCacheHeader header = {};
+	if (!reader.read(&header, sizeof(header)))
+		return false;
+	if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 || header.version != MESH_CACHE_VERSION
+			|| header.vertexSize != sizeof(Vertex3) || ((header.flags & MESH_CACHE_FLAG_OPTIMIZED) != 0) != optimized)
+		return false;
+
+	// Stamps matched through their hash only are rewritten with the current mtime once the cache is known good
+	std::vector<std::pair<size_t, int64_t>> touchedMtimes;
+	bool touched = false;
+	if (!sourceUnchanged(stamp, true, header.sourceSize, header.sourceMtime, header.sourceHash, touched))
+		return false;
+	if (touched)
+		touchedMtimes.emplace_back(offsetof(MeshCacheHeader, sourceMtime), stamp.mtime);
+
+	if (header.materialFileCount > reader.remaining() / MATERIAL_FILE_MIN_SIZE)
+		return false;
+	mesh.materialFiles.resize(header.materialFileCount);
+	for (std::string& materialFile : mesh.materialFiles) {
+		uint64_t size, hash;
+		int64_t mtime;
+		if (!reader.readString(materialFile) || !reader.read(&size, sizeof(size)))
+			return false;
+		size_t mtimeOffset = size_t(reader.cursor - file.data);
+		if (!reader.read(&mtime, sizeof(mtime)) || !reader.read(&hash, sizeof(hash)))
+			return false;
+		FileStamp current;
+		bool exists = stampFile(materialFile, current);
+		touched = false;
+		if (!sourceUnchanged(current, exists, size, mtime, hash, touched))
+			return false;
+		if (touched)
+			touchedMtimes.emplace_back(mtimeOffset, current.mtime);
+	}
+
+	// Counts are checked against what is left of the file before anything is allocated for them
+	uint64_t remaining = reader.remaining();
+	if (header.vertexCount > remaining / sizeof(Vertex3))
+		return false;
+	remaining -= header.vertexCount * sizeof(Vertex3);
+	if (header.indexCount > remaining / sizeof(uint32_t))
+		return false;
+	remaining -= header.indexCount * sizeof(uint32_t);
+	if (header.submeshCount > remaining / sizeof(Submesh))
+		return false;
+	remaining -= header.submeshCount * sizeof(Submesh);
+	if (header.materialCount > remaining / MATERIAL_MIN_SIZE)
+		return false;
+
+	mesh.vertices.resize(size_t(header.vertexCount));
+	mesh.indices.resize(size_t(header.indexCount));
+	if (!reader.read(mesh.vertices.data(), sizeof(Vertex3) * mesh.vertices.size())
+			|| !reader.read(mesh.indices.data(), sizeof(uint32_t) * mesh.indices.size()))
+		return false;
+	for (uint32_t index : mesh.indices)
+		if (index >= header.vertexCount)
+			return false;
+
+	mesh.submeshes.resize(header.submeshCount);
+	if (!reader.read(mesh.submeshes.data(), sizeof(Submesh) * mesh.submeshes.size()))
+		return false;
+	for (const Submesh& submesh : mesh.submeshes)
+		if (submesh.materialId < 0 || submesh.materialId >= int(header.materialCount)
+				|| uint64_t(submesh.firstIndex) + submesh.indexCount > header.indexCount)
+			return false;
+
+	mesh.materials.clear();
+	mesh.materials.resize(header.materialCount);
+	for (tinyobj::material_t& material : mesh.materials) {
+		if (!reader.readString(material.name) || !reader.readString(material.diffuse_texname)
+				|| !reader.read(material.ambient, sizeof(material.ambient))
+				|| !reader.read(material.diffuse, sizeof(material.diffuse))
+				|| !reader.read(material.specular, sizeof(material.specular))
+				|| !reader.read(&material.shininess, sizeof(material.shininess))
+				|| !reader.read(&material.dissolve, sizeof(material.dissolve)))
+			return false;
+	}
+
+	mesh.cornerCount = size_t(header.cornerCount);
+	mesh.boundsMin = { header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] };
+	mesh.boundsMax = { header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] };
+
+	// Patched in place once the mapping is gone; a failure only means hashing again next time
+	file.close();
+	if (!touchedMtimes.empty()) {
+		std::fstream out(cacheFile, std::ios::in | std::ios::out | std::ios::binary);
+		for (const auto& touchedMtime : touchedMtimes) {
+			out.seekp(std::streamoff(touchedMtime.first));
+			out.write(reinterpret_cast<const char*>(&touchedMtime.second), sizeof(touchedMtime.second));
+		}
+	}
+	return true;
+}
+
+bool writeMeshCache(const std::string& cacheFile, FileStamp& stamp, bool optimized, const Mesh& mesh) {
+	if (!hashFile(stamp))
+		return false;
+
+	MeshCacheHeader header = {};
+	std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+	header.version = MESH_CACHE_VERSION;
+	header.vertexSize = sizeof(Vertex3);
+	header.flags = optimized ? MESH_CACHE_FLAG_OPTIMIZED : 0;
+	header.sourceSize = stamp.size;
+	header.sourceMtime = stamp.mtime;
+	header.sourceHash = stamp.hash;
+	header.vertexCount = mesh.vertices.size();
+	header.indexCount = mesh.indices.size();
+	header.cornerCount = mesh.cornerCount;
+	header.materialCount = uint32_t(mesh.materials.size());
+	header.submeshCount = uint32_t(mesh.submeshes.size());
+	header.materialFileCount = uint32_t(mesh.materialFiles.size());
+	for (int i = 0; i < 3; i++) {
+		header.boundsMin[i] = mesh.boundsMin[i];
+		header.boundsMax[i] = mesh.boundsMax[i];
+	}
+
+	// Written under a temporary name so that a crash never leaves a truncated cache behind
+	std::string tempFile = cacheFile + ".tmp";
+	{
+		std::ofstream out(tempFile, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const std::string& materialFile : mesh.materialFiles) {
+			FileStamp materialStamp;
+			if (!stampFile(materialFile, materialStamp))
+				materialStamp.size = MESH_CACHE_MISSING_FILE;
+			else if (!hashFile(materialStamp))
+				return false;
+			writeString(out, materialFile);
+			out.write(reinterpret_cast<const char*>(&materialStamp.size), sizeof(materialStamp.size));
+			out.write(reinterpret_cast<const char*>(&materialStamp.mtime), sizeof(materialStamp.mtime));
+			out.write(reinterpret_cast<const char*>(&materialStamp.hash), sizeof(materialStamp.hash));
+		}
+		out.write(reinterpret_cast<const char*>(mesh.vertices.data()), std::streamsize(sizeof(Vertex3) * mesh.vertices.size()));
+		out.write(reinterpret_cast<const char*>(mesh.indices.data()), std::streamsize(sizeof(uint32_t) * mesh.indices.size()));
+		out.write(reinterpret_cast<const char*>(mesh.submeshes.data()), std::streamsize(sizeof(Submesh) * mesh.submeshes.size()));
+		for (const tinyobj::material_t& material : mesh.materials) {
+			writeString(out, material.name);
+			writeString(out, material.diffuse_texname);
+			out.write(reinterpret_cast<const char*>(material.ambient), sizeof(material.ambient));
+			out.write(reinterpret_cast<const char*>(material.diffuse), sizeof(material.diffuse));
+			out.write(reinterpret_cast<const char*>(material.specular), sizeof(material.specular));
+			out.write(reinterpret_cast<const char*>(&material.shininess), sizeof(material.shininess));
+			out.write(reinterpret_cast<const char*>(&material.dissolve), sizeof(material.dissolve));
+		}
+		if (!out)
+			return false;
+	}
+	std::remove(cacheFile.c_str());
+	return std::rename(tempFile.c_str(), cacheFile.c_str()) == 0;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "FileStamp.h"
+#include "Mesh.h"
+#include <cstdint>
+#include <string>
+
+const char* const MESH_CACHE_EXTENSION = ".meshcache";
+const uint32_t MESH_CACHE_VERSION = 3;
+
+// The cache also records the material libraries listed in mesh.materialFiles, and is only valid while they are unchanged
+bool readMeshCache(const std::string& cacheFile, FileStamp& stamp, bool optimized, Mesh& mesh);
+bool writeMeshCache(const std::string& cacheFile, FileStamp& stamp, bool optimized, const Mesh& mesh);
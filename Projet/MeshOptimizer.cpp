@@ -0,0 +1,290 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+	const size_t FORSYTH_CACHE_SIZE = 32;
+	const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+	const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+	const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+	const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+	float forsythScore(int cachePosition, uint32_t remainingTriangles) {
+		if (remainingTriangles == 0)
+			return -1;
+
+		float score = 0;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3) {
+				// The three vertices of the last triangle get a fixed score so that strips are not favored
+				score = FORSYTH_LAST_TRIANGLE_SCORE;
+			} else {
+				const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+				score = std::pow(1.0f - float(cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+			}
+		}
+		// Vertices with few triangles left are boosted to avoid leaving lonely triangles behind
+		score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(float(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+		return score;
+	}
+}
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize) {
+	VertexCacheStats stats;
+	// Each vertex remembers the miss count at which it entered the FIFO
+	std::vector<size_t> cacheTimestamps(vertexCount, 0);
+	size_t timestamp = cacheSize + 1;
+
+	for (size_t i = 0; i < indexCount; i++) {
+		uint32_t index = indices[i];
+		if (timestamp - cacheTimestamps[index] > cacheSize) {
+			cacheTimestamps[index] = timestamp++;
+			stats.transformedVertices++;
+		}
+	}
+
+	size_t triangleCount = indexCount / 3;
+	stats.acmr = triangleCount == 0 ? 0 : float(stats.transformedVertices) / float(triangleCount);
+	stats.atvr = vertexCount == 0 ? 0 : float(stats.transformedVertices) / float(vertexCount);
+	return stats;
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Vertex -> triangles adjacency, stored as offsets into a single array
+	std::vector<uint32_t> triangleCounts(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; i++)
+		triangleCounts[indices[i]]++;
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + triangleCounts[v];
+	std::vector<uint32_t> adjacency(indexCount);
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < indexCount; i++)
+		adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+
+	// Remaining triangles are kept at the front of each vertex adjacency list
+	std::vector<uint32_t> remaining = triangleCounts;
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = forsythScore(-1, remaining[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScores[t] = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	size_t cacheCount = 0;
+	size_t scanCursor = 0;
+
+	while (output.size() < indexCount) {
+		// Best triangle among those touching the cache
+		long best = -1;
+		float bestScore = -std::numeric_limits<float>::max();
+		for (size_t c = 0; c < cacheCount; c++) {
+			uint32_t v = cache[c];
+			for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v] + remaining[v]; a++) {
+				uint32_t t = adjacency[a];
+				if (triangleScores[t] > bestScore) {
+					bestScore = triangleScores[t];
+					best = long(t);
+				}
+			}
+		}
+		// The cache has nothing to offer, continue with the next triangle in input order
+		if (best < 0) {
+			while (emitted[scanCursor])
+				scanCursor++;
+			best = long(scanCursor);
+		}
+
+		auto t = size_t(best);
+		emitted[t] = true;
+		uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+		size_t newCacheCount = 0;
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t v = indices[3 * t + k];
+			output.push_back(v);
+			newCache[newCacheCount++] = v;
+
+			// Remove the triangle from the vertex adjacency
+			uint32_t begin = adjacencyOffsets[v];
+			uint32_t end = begin + remaining[v];
+			for (uint32_t a = begin; a < end; a++) {
+				if (adjacency[a] == t) {
+					std::swap(adjacency[a], adjacency[end - 1]);
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+		for (size_t c = 0; c < cacheCount; c++) {
+			uint32_t v = cache[c];
+			if (v != newCache[0] && v != newCache[1] && v != newCache[2])
+				newCache[newCacheCount++] = v;
+		}
+
+		// Vertices pushed out of the cache lose their cache position
+		for (size_t c = FORSYTH_CACHE_SIZE; c < newCacheCount; c++)
+			cachePositions[newCache[c]] = -1;
+		cacheCount = std::min(newCacheCount, FORSYTH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		// Update the scores of every vertex that moved and of their remaining triangles
+		for (size_t c = 0; c < newCacheCount; c++) {
+			uint32_t v = newCache[c];
+			if (c < FORSYTH_CACHE_SIZE)
+				cachePositions[v] = int(c);
+			float score = forsythScore(cachePositions[v], remaining[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+			for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v] + remaining[v]; a++)
+				triangleScores[adjacency[a]] += delta;
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex3>& vertices, float threshold, size_t cacheSize) {
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+		return;
+
+	// A triangle missing the cache on all three vertices starts a hard cluster: moving clusters around
+	// at those boundaries does not change the vertex cache efficiency
+	std::vector<size_t> hardStarts;
+	std::vector<size_t> cacheTimestamps(vertices.size(), 0);
+	size_t timestamp = cacheSize + 1;
+	auto simulate = [&](size_t t) {
+		int misses = 0;
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t index = indices[3 * t + k];
+			if (timestamp - cacheTimestamps[index] > cacheSize) {
+				cacheTimestamps[index] = timestamp++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+	auto flush = [&]() {
+		timestamp += cacheSize + 1;
+	};
+	for (size_t t = 0; t < triangleCount; t++) {
+		if (simulate(t) == 3 || t == 0)
+			hardStarts.push_back(t);
+	}
+	hardStarts.push_back(triangleCount);
+
+	// Hard clusters are split further (Sander et al. 2007): starting from a flushed cache, a cluster is cut
+	// as soon as its running ACMR falls to `threshold` times the ACMR of the whole hard cluster, so that
+	// drawing the pieces in any order costs at most that factor in vertex transforms
+	std::vector<size_t> clusterStarts;
+	for (size_t h = 0; h + 1 < hardStarts.size(); h++) {
+		size_t first = hardStarts[h];
+		size_t last = hardStarts[h + 1];
+		flush();
+		size_t clusterMisses = 0;
+		for (size_t t = first; t < last; t++)
+			clusterMisses += simulate(t);
+		float clusterThreshold = threshold * float(clusterMisses) / float(last - first);
+
+		clusterStarts.push_back(first);
+		flush();
+		size_t runningMisses = 0;
+		size_t runningTriangles = 0;
+		for (size_t t = first; t + 1 < last; t++) {
+			runningMisses += simulate(t);
+			runningTriangles++;
+			if (float(runningMisses) <= clusterThreshold * float(runningTriangles)) {
+				clusterStarts.push_back(t + 1);
+				flush();
+				runningMisses = 0;
+				runningTriangles = 0;
+			}
+		}
+	}
+	if (clusterStarts.size() < 2)
+		return;
+
+	// Occlusion potential is measured against the area weighted centroid of the triangles being sorted
+	glm::vec3 meshCentroid = { 0, 0, 0 };
+	float meshArea = 0;
+	for (size_t t = 0; t < triangleCount; t++) {
+		const glm::vec3& p0 = vertices[indices[3 * t]].position;
+		const glm::vec3& p1 = vertices[indices[3 * t + 1]].position;
+		const glm::vec3& p2 = vertices[indices[3 * t + 2]].position;
+		float a = glm::length(glm::cross(p1 - p0, p2 - p0));
+		meshCentroid += (p0 + p1 + p2) * (a / 3);
+		meshArea += a;
+	}
+	if (meshArea > 0)
+		meshCentroid /= meshArea;
+
+	// View independent occlusion potential: clusters facing away from the center are likely to occlude the others
+	std::vector<float> sortKeys(clusterStarts.size());
+	for (size_t c = 0; c < clusterStarts.size(); c++) {
+		size_t first = clusterStarts[c];
+		size_t last = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+		glm::vec3 centroid = { 0, 0, 0 };
+		glm::vec3 normal = { 0, 0, 0 };
+		float area = 0;
+		for (size_t t = first; t < last; t++) {
+			const glm::vec3& p0 = vertices[indices[3 * t]].position;
+			const glm::vec3& p1 = vertices[indices[3 * t + 1]].position;
+			const glm::vec3& p2 = vertices[indices[3 * t + 2]].position;
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float a = glm::length(n);
+			centroid += (p0 + p1 + p2) * (a / 3);
+			normal += n;
+			area += a;
+		}
+		if (area > 0)
+			centroid /= area;
+		float normalLength = glm::length(normal);
+		if (normalLength > 0)
+			normal /= normalLength;
+		sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+	}
+
+	std::vector<size_t> order(clusterStarts.size());
+	for (size_t c = 0; c < order.size(); c++)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+	for (size_t c : order) {
+		size_t first = clusterStarts[c];
+		size_t last = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+		output.insert(output.end(), indices + 3 * first, indices + 3 * last);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeVertexFetch(std::vector<Vertex3>& vertices, std::vector<uint32_t>& indices) {
+	const uint32_t unused = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> remap(vertices.size(), unused);
+	std::vector<Vertex3> output;
+	output.reserve(vertices.size());
+
+	for (uint32_t& index : indices) {
+		if (remap[index] == unused) {
+			remap[index] = uint32_t(output.size());
+			output.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(output);
+}
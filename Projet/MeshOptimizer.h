@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Mesh.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Result of simulating a FIFO post-transform vertex cache over an index buffer
+struct VertexCacheStats {
+	size_t transformedVertices = 0;
+	// Average cache miss ratio: transformed vertices per triangle (0.5 is optimal, 3 is worst)
+	float acmr = 0;
+	// Average transform to vertex ratio: transformed vertices per unique vertex (1 is optimal)
+	float atvr = 0;
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize = 16);
+
+// Reorders triangles for the post-transform vertex cache (Tom Forsyth's linear-speed algorithm)
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+// Splits the output of optimizeVertexCache into clusters and draws the outward facing ones first.
+// `threshold` is the vertex cache ACMR increase accepted in exchange for smaller clusters (1.05: 5%)
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex3>& vertices, float threshold = 1.05f, size_t cacheSize = 16);
+
+// Sorts vertices in the order they are first referenced and drops unused ones
+void optimizeVertexFetch(std::vector<Vertex3>& vertices, std::vector<uint32_t>& indices);
@@ -0,0 +1,146 @@
+#include "MipChain.h"
+#include <algorithm>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// Linear values are quantized to 12 bits before encoding, within one sRGB step over the whole range
+	const int LINEAR_STEPS = 4095;
+
+	struct SrgbTables {
+		float toLinear[256];
+		uint8_t toSrgb[LINEAR_STEPS + 1];
+
+		SrgbTables() {
+			for (int i = 0; i < 256; i++) {
+				float c = i / 255.f;
+				this->toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i <= LINEAR_STEPS; i++) {
+				float l = float(i) / LINEAR_STEPS;
+				float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1 / 2.4f) - 0.055f;
+				this->toSrgb[i] = uint8_t(std::min(255.f, c * 255.f + 0.5f));
+			}
+		}
+	};
+
+	const SrgbTables& srgbTables() {
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	// Source texels averaged into one target texel along one axis. Halving an odd size takes three texels per target,
+	// weighted by how much of each the target covers, so that the last row or column is not dropped
+	struct FilterTaps {
+		int first;
+		int count;
+		float weights[3];
+	};
+
+	FilterTaps filterTaps(int target, int size, int targetSize) {
+		if (size == 1)
+			return { 0, 1, { 1, 0, 0 } };
+		if (size % 2 == 0)
+			return { 2 * target, 2, { 0.5f, 0.5f, 0 } };
+		float scale = 1.f / float(size);
+		return { 2 * target, 3, { float(targetSize - target) * scale, float(targetSize) * scale, float(target + 1) * scale } };
+	}
+
+	// One RGBA pixel per 4 floats
+	void downsample(const std::vector<float>& source, int width, int height, std::vector<float>& target, int targetWidth, int targetHeight) {
+		target.resize(size_t(4) * targetWidth * targetHeight);
+		// Even sizes, by far the most common: a plain 2x2 box
+		if (width % 2 == 0 && height % 2 == 0) {
+			for (int y = 0; y < targetHeight; y++) {
+				const float* row0 = &source[size_t(4) * (2 * y) * width];
+				const float* row1 = row0 + size_t(4) * width;
+				float* out = &target[size_t(4) * y * targetWidth];
+				for (int x = 0; x < targetWidth; x++) {
+#ifdef __SSE2__
+					__m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + 8 * x), _mm_loadu_ps(row0 + 8 * x + 4)),
+						_mm_add_ps(_mm_loadu_ps(row1 + 8 * x), _mm_loadu_ps(row1 + 8 * x + 4)));
+					_mm_storeu_ps(out + 4 * x, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+					for (int c = 0; c < 4; c++)
+						out[4 * x + c] = (row0[8 * x + c] + row0[8 * x + 4 + c] + row1[8 * x + c] + row1[8 * x + 4 + c]) * 0.25f;
+#endif
+				}
+			}
+			return;
+		}
+
+		std::vector<FilterTaps> columns(targetWidth);
+		for (int x = 0; x < targetWidth; x++)
+			columns[x] = filterTaps(x, width, targetWidth);
+		for (int y = 0; y < targetHeight; y++) {
+			FilterTaps rows = filterTaps(y, height, targetHeight);
+			float* out = &target[size_t(4) * y * targetWidth];
+			for (int x = 0; x < targetWidth; x++) {
+				const FilterTaps& taps = columns[x];
+#ifdef __SSE2__
+				__m128 sum = _mm_setzero_ps();
+				for (int r = 0; r < rows.count; r++) {
+					const float* row = &source[size_t(4) * ((size_t(rows.first) + r) * width + taps.first)];
+					for (int c = 0; c < taps.count; c++)
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + 4 * c), _mm_set1_ps(rows.weights[r] * taps.weights[c])));
+				}
+				_mm_storeu_ps(out + 4 * x, sum);
+#else
+				float sum[4] = { 0, 0, 0, 0 };
+				for (int r = 0; r < rows.count; r++) {
+					const float* row = &source[size_t(4) * ((size_t(rows.first) + r) * width + taps.first)];
+					for (int c = 0; c < taps.count; c++)
+						for (int k = 0; k < 4; k++)
+							sum[k] += row[4 * c + k] * rows.weights[r] * taps.weights[c];
+				}
+				for (int k = 0; k < 4; k++)
+					out[4 * x + k] = sum[k];
+#endif
+			}
+		}
+	}
+
+	void encode(const std::vector<float>& linear, TextureLevel& level) {
+		const SrgbTables& tables = srgbTables();
+		size_t pixels = size_t(level.width) * level.height;
+		level.data.resize(4 * pixels);
+		for (size_t i = 0; i < pixels; i++) {
+			int32_t steps[4];
+#ifdef __SSE2__
+			__m128 scaled = _mm_mul_ps(_mm_loadu_ps(&linear[4 * i]), _mm_setr_ps(LINEAR_STEPS, LINEAR_STEPS, LINEAR_STEPS, 255));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(steps), _mm_cvtps_epi32(scaled));
+#else
+			for (int c = 0; c < 4; c++)
+				steps[c] = int32_t(std::lround(linear[4 * i + c] * (c < 3 ? LINEAR_STEPS : 255)));
+#endif
+			for (int c = 0; c < 3; c++)
+				level.data[4 * i + c] = tables.toSrgb[std::min(std::max(steps[c], 0), LINEAR_STEPS)];
+			level.data[4 * i + 3] = uint8_t(std::min(std::max(steps[3], 0), 255));
+		}
+	}
+}
+
+void buildMipChain(std::vector<TextureLevel>& levels) {
+	const SrgbTables& tables = srgbTables();
+	int width = levels[0].width, height = levels[0].height;
+	const std::vector<uint8_t>& texels = levels[0].data;
+	std::vector<float> linear(texels.size()), next;
+	for (size_t i = 0; i < texels.size(); i += 4) {
+		linear[i] = tables.toLinear[texels[i]];
+		linear[i + 1] = tables.toLinear[texels[i + 1]];
+		linear[i + 2] = tables.toLinear[texels[i + 2]];
+		linear[i + 3] = texels[i + 3] / 255.f;
+	}
+
+	while (width > 1 || height > 1) {
+		int nextWidth = std::max(1, width / 2), nextHeight = std::max(1, height / 2);
+		downsample(linear, width, height, next, nextWidth, nextHeight);
+		linear.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+		levels.push_back({ width, height, {} });
+		encode(linear, levels.back());
+	}
+}
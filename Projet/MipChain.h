@@ -0,0 +1,9 @@
+#pragma once
+
+#include "TextureCache.h"
+#include <vector>
+
+// Appends the mip levels of levels[0] (RGBA8, sRGB colour and linear alpha) down to 1x1.
+// Each level is a box filter of the previous one, averaged in linear light on floats so that rounding does not
+// accumulate down the chain: 2x2 texels on even sizes, three texels weighted by coverage along odd ones
+void buildMipChain(std::vector<TextureLevel>& levels);
@@ -0,0 +1,43 @@
+#include "RenderQueue.h"
+#include <algorithm>
+
+uint64_t RenderQueue::makeKey(uint32_t pass, uint32_t program, uint32_t texture, uint32_t vao, float depth) {
+	uint64_t quantizedDepth = uint64_t(std::min(std::max(depth, 0.f), 1.f) * 0xFFFF);
+	return uint64_t(pass & 0xF) << 60
+		| uint64_t(program & 0xFFF) << 48
+		| uint64_t(texture & 0xFFFF) << 32
+		| uint64_t(vao & 0xFFFF) << 16
+		| quantizedDepth;
+}
+
+void RenderQueue::sort() {
+	size_t count = this->items.size();
+	if (count < 2)
+		return;
+	this->scratch.resize(count);
+
+	// All the histograms in a single pass over the keys
+	uint32_t histograms[8][256] = {};
+	for (const RenderItem& item : this->items)
+		for (int byte = 0; byte < 8; byte++)
+			histograms[byte][(item.key >> (byte * 8)) & 0xFF]++;
+
+	RenderItem* source = this->items.data();
+	RenderItem* destination = this->scratch.data();
+	for (int byte = 0; byte < 8; byte++) {
+		uint32_t* histogram = histograms[byte];
+		if (histogram[(source[0].key >> (byte * 8)) & 0xFF] == count)
+			continue;
+		uint32_t offset = 0;
+		for (int bucket = 0; bucket < 256; bucket++) {
+			uint32_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+		for (size_t i = 0; i < count; i++)
+			destination[histogram[(source[i].key >> (byte * 8)) & 0xFF]++] = source[i];
+		std::swap(source, destination);
+	}
+	if (source != this->items.data())
+		this->items.swap(this->scratch);
+}
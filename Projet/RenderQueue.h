@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Draws to submit this frame, each identified by `index` in a caller-side command array and ordered by `key`
+struct RenderItem {
+	uint64_t key;
+	uint32_t index;
+};
+
+// Per-frame list of draws, radix sorted by a key packing the state they need,
+// so that consecutive draws share as much state as possible
+struct RenderQueue {
+	std::vector<RenderItem> items;
+	std::vector<RenderItem> scratch;
+
+	// Bits, from most to least significant: pass (4), program (12), texture (16), vertex array (16), depth (16).
+	// GL names are truncated, which only costs some sorting accuracy. `depth` is in [0, 1], front to back
+	static uint64_t makeKey(uint32_t pass, uint32_t program, uint32_t texture, uint32_t vao, float depth);
+
+	inline void clear() {
+		this->items.clear();
+	}
+
+	inline void push(uint64_t key, uint32_t index) {
+		this->items.push_back({ key, index });
+	}
+
+	// Stable LSD radix sort on bytes, skipping the bytes that are equal for every item
+	void sort();
+};
@@ -0,0 +1,132 @@
+#include "RingBuffer.h"
+#include <chrono>
+#include <iostream>
+
+bool RingBuffer::initialize(GLenum target, GLsizeiptr regionSize, GLintptr alignment) {
+	this->target = target;
+	this->alignment = alignment > 0 ? alignment : 1;
+	this->regionSize = (regionSize + this->alignment - 1) / this->alignment * this->alignment;
+	this->persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+	glGenBuffers(1, &this->buffer);
+	glBindBuffer(target, this->buffer);
+	if (this->persistent) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, this->regionSize * RING_FRAMES, nullptr, flags);
+		this->mapped = static_cast<uint8_t*>(glMapBufferRange(target, 0, this->regionSize * RING_FRAMES, flags));
+		if (!this->mapped) {
+			// Immutable storage cannot be reallocated, start over with a mutable buffer
+			glBindBuffer(target, 0);
+			glDeleteBuffers(1, &this->buffer);
+			glGenBuffers(1, &this->buffer);
+			glBindBuffer(target, this->buffer);
+			this->persistent = false;
+		}
+	}
+	if (!this->persistent) {
+		glBufferData(target, this->regionSize, nullptr, GL_STREAM_DRAW);
+		this->staging.resize(size_t(this->regionSize));
+	}
+	glBindBuffer(target, 0);
+
+	std::cout << "RingBuffer: " << RING_FRAMES << " x " << this->regionSize << " bytes, "
+		<< (this->persistent ? "persistently mapped" : "orphaned uploads") << std::endl;
+	return this->buffer != 0;
+}
+
+void RingBuffer::destroy() {
+	for (GLsync& fence : this->fences) {
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (this->mapped) {
+		glBindBuffer(this->target, this->buffer);
+		glUnmapBuffer(this->target);
+		glBindBuffer(this->target, 0);
+		this->mapped = nullptr;
+	}
+	glDeleteBuffers(1, &this->buffer);
+	this->buffer = 0;
+}
+
+bool RingBuffer::beginFrame() {
+	bool grown = false;
+	if (this->frameOverflows > 0) {
+		// Half as much again, so that a slowly growing frame does not reallocate every time. The buffer may still be
+		// in use by the GPU, GL only releases it once the frames reading it are done
+		GLsizeiptr regionSize = this->demand + this->demand / 2;
+		std::cout << "RingBuffer: " << this->frameOverflows << " allocations did not fit in " << this->regionSize
+			<< " bytes, growing" << std::endl;
+		GLenum target = this->target;
+		GLintptr alignment = this->alignment;
+		this->destroy();
+		this->initialize(target, regionSize, alignment);
+		this->region = 0;
+		this->grows++;
+		grown = true;
+	}
+	this->head = 0;
+	this->demand = 0;
+	this->frameOverflows = 0;
+	this->frameBytes = 0;
+	this->frameWaitMs = 0;
+	if (!this->persistent)
+		return grown;
+
+	this->region = (this->region + 1) % RING_FRAMES;
+	GLsync& fence = this->fences[this->region];
+	if (!fence)
+		return grown;
+	auto start = std::chrono::steady_clock::now();
+	GLbitfield flags = 0;
+	for (;;) {
+		GLenum status = glClientWaitSync(fence, flags, 1000000);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED)
+			break;
+		// The fence may still sit in an unflushed command buffer
+		flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	}
+	this->frameWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	glDeleteSync(fence);
+	fence = nullptr;
+	return grown;
+}
+
+GLintptr RingBuffer::allocate(GLsizeiptr size, void** data) {
+	GLsizeiptr offset = (this->head + this->alignment - 1) / this->alignment * this->alignment;
+	this->demand = (this->demand + this->alignment - 1) / this->alignment * this->alignment + size;
+	if (offset + size > this->regionSize) {
+		this->overflows++;
+		this->frameOverflows++;
+		*data = nullptr;
+		return -1;
+	}
+	this->head = offset + size;
+	this->frameBytes += size;
+	if (this->persistent) {
+		GLintptr base = this->region * this->regionSize;
+		*data = this->mapped + base + offset;
+		return base + offset;
+	}
+	*data = this->staging.data() + offset;
+	return offset;
+}
+
+void RingBuffer::flush() {
+	// Coherent mappings need no flush
+	if (this->persistent || this->head == 0)
+		return;
+	glBindBuffer(this->target, this->buffer);
+	glBufferData(this->target, this->regionSize, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(this->target, 0, this->head, this->staging.data());
+	glBindBuffer(this->target, 0);
+}
+
+void RingBuffer::endFrame() {
+	if (this->persistent)
+		this->fences[this->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	this->frames++;
+	this->totalBytes += uint64_t(this->frameBytes);
+	this->totalWaitMs += this->frameWaitMs;
+}
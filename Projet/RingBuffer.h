@@ -0,0 +1,51 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+
+// Per-frame allocator for dynamic GPU data.
+// The buffer is split into RING_FRAMES regions, persistently mapped when GL_ARB_buffer_storage is available:
+// the CPU writes frame N while the GPU still reads frames N-1 and N-2, and a fence guards each region's reuse.
+// Without buffer storage, frames are staged in memory and uploaded into an orphaned buffer by flush().
+// A frame that did not fit makes the next beginFrame() replace the buffer by one large enough for it
+struct RingBuffer {
+	static const int RING_FRAMES = 3;
+
+	GLenum target = GL_UNIFORM_BUFFER;
+	GLuint buffer = 0;
+	GLsizeiptr regionSize = 0;
+	GLintptr alignment = 1;
+	bool persistent = false;
+	uint8_t* mapped = nullptr;
+	std::vector<uint8_t> staging;
+	GLsync fences[RING_FRAMES] = {};
+	int region = 0;
+	GLsizeiptr head = 0;
+	// Bytes the frame asked for, including the allocations refused
+	GLsizeiptr demand = 0;
+	uint32_t frameOverflows = 0;
+
+	// Stats of the last completed frame, and totals since initialize
+	GLsizeiptr frameBytes = 0;
+	double frameWaitMs = 0;
+	uint64_t frames = 0;
+	uint64_t totalBytes = 0;
+	double totalWaitMs = 0;
+	uint64_t overflows = 0;
+	uint32_t grows = 0;
+
+	bool initialize(GLenum target, GLsizeiptr regionSize, GLintptr alignment);
+	void destroy();
+
+	// Waits, if ever needed, for the GPU to release the next region.
+	// Returns true when the last frame overflowed and `buffer` was replaced: bindings of the old name are stale
+	bool beginFrame();
+	// Returns the offset of `size` writable bytes in `buffer`, or -1 when the region is full.
+	// Nothing must then be drawn from it this frame
+	GLintptr allocate(GLsizeiptr size, void** data);
+	// Makes this frame's allocations visible to the GPU, call once they are written and before drawing
+	void flush();
+	// Fences the region after the frame's last draw call
+	void endFrame();
+};
@@ -0,0 +1,38 @@
+#include "ShaderCache.h"
+#include <iostream>
+
+GLShader* ShaderCache::acquire(const char* vertexFile, const char* geometryFile, const char* fragmentFile) {
+	this->requests++;
+	std::string key = std::string(vertexFile) + '\n' + (geometryFile ? geometryFile : "") + '\n' + fragmentFile;
+	auto it = this->programs.find(key);
+	if (it != this->programs.end()) {
+		it->second.references++;
+		return &it->second.shader;
+	}
+
+	Entry& entry = this->programs[key];
+	bool compiled = entry.shader.LoadVertexShader(vertexFile);
+	if (geometryFile)
+		compiled &= entry.shader.LoadGeometryShader(geometryFile);
+	compiled &= entry.shader.LoadFragmentShader(fragmentFile);
+	if (!compiled || !entry.shader.Create()) {
+		std::cerr << "ShaderCache: cannot build program " << vertexFile << " + " << fragmentFile << std::endl;
+		this->programs.erase(key);
+		return nullptr;
+	}
+
+	entry.references = 1;
+	return &entry.shader;
+}
+
+void ShaderCache::release(GLShader* shader) {
+	for (auto it = this->programs.begin(); it != this->programs.end(); ++it) {
+		if (&it->second.shader != shader)
+			continue;
+		if (--it->second.references == 0) {
+			it->second.shader.Destroy();
+			this->programs.erase(it);
+		}
+		return;
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "GLShader.h"
+#include <map>
+#include <string>
+
+// Compiles each (vertex, geometry, fragment) combination once and shares the resulting program
+struct ShaderCache {
+	struct Entry {
+		GLShader shader;
+		int references = 0;
+	};
+
+	std::map<std::string, Entry> programs;
+	int requests = 0;
+
+	// geometryFile may be null. Returns null when the program does not compile or link
+	GLShader* acquire(const char* vertexFile, const char* geometryFile, const char* fragmentFile);
+	// Destroys the program once its last user released it
+	void release(GLShader* shader);
+
+	inline size_t size() const {
+		return this->programs.size();
+	}
+};
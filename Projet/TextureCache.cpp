@@ -0,0 +1,189 @@
+#include "TextureCache.h"
+#include "BlockCompression.h"
+#include "MappedFile.h"
+#include "MipChain.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+	const uint32_t DDS_FOURCC_DXT1 = 0x31545844;
+	const uint32_t DDS_FOURCC_DXT5 = 0x35545844;
+	const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+	const uint32_t DDPF_ALPHAPIXELS = 0x1, DDPF_FOURCC = 0x4, DDPF_RGB = 0x40;
+	const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+	// Written in the reserved words, with the cache version and the stamp of the source image
+	const uint32_t TEXTURE_CACHE_MARKER = 0x4A424F54;
+
+	struct DdsPixelFormat {
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t masks[4];
+	};
+
+	// Standard DDS header; reserved[] holds the cache version, the source stamp and a marker
+	struct DdsHeader {
+		char magic[4];
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t version;
+		uint32_t marker;
+		uint64_t sourceSize;
+		int64_t sourceMtime;
+		uint64_t sourceHash;
+		uint32_t reserved[3];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps[4];
+		uint32_t reserved2;
+	};
+	static_assert(sizeof(DdsHeader) == 128, "DdsHeader must match the DDS file layout");
+
+	size_t levelSize(TextureFormat format, int width, int height) {
+		if (format == TextureFormat::RGBA8)
+			return size_t(4) * width * height;
+		size_t blocks = size_t(std::max(1, (width + 3) / 4)) * std::max(1, (height + 3) / 4);
+		return blocks * (format == TextureFormat::BC1 ? BC1_BLOCK_SIZE : BC3_BLOCK_SIZE);
+	}
+}
+
+bool readTextureCache(const std::string& cacheFile, FileStamp& stamp, TextureImage& image) {
+	MappedFile file;
+	if (!file.open(cacheFile) || file.size < sizeof(DdsHeader))
+		return false;
+	DdsHeader header;
+	std::memcpy(&header, file.data, sizeof(header));
+	if (std::memcmp(header.magic, "DDS ", 4) != 0 || header.size != sizeof(DdsHeader) - 4
+			|| header.marker != TEXTURE_CACHE_MARKER || header.version != TEXTURE_CACHE_VERSION)
+		return false;
+	if (header.sourceSize != stamp.size)
+		return false;
+	if (header.sourceMtime != stamp.mtime && (!hashFile(stamp) || header.sourceHash != stamp.hash))
+		return false;
+
+	if (header.pixelFormat.flags & DDPF_FOURCC) {
+		if (header.pixelFormat.fourCC == DDS_FOURCC_DXT1)
+			image.format = TextureFormat::BC1;
+		else if (header.pixelFormat.fourCC == DDS_FOURCC_DXT5)
+			image.format = TextureFormat::BC3;
+		else
+			return false;
+	} else if (header.pixelFormat.rgbBitCount == 32 && header.pixelFormat.masks[0] == 0xFF) {
+		image.format = TextureFormat::RGBA8;
+	} else {
+		return false;
+	}
+
+	const uint8_t* cursor = file.data + sizeof(header);
+	const uint8_t* end = file.data + file.size;
+	int width = int(header.width), height = int(header.height);
+	image.levels.clear();
+	for (uint32_t i = 0; i < std::max(header.mipMapCount, 1u); i++) {
+		size_t size = levelSize(image.format, width, height);
+		if (size_t(end - cursor) < size)
+			return false;
+		image.levels.push_back({ width, height, std::vector<uint8_t>(cursor, cursor + size) });
+		cursor += size;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return true;
+}
+
+bool writeTextureCache(const std::string& cacheFile, FileStamp& stamp, const TextureImage& image) {
+	if (image.levels.empty() || !hashFile(stamp))
+		return false;
+
+	DdsHeader header = {};
+	std::memcpy(header.magic, "DDS ", 4);
+	header.size = sizeof(DdsHeader) - 4;
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header.width = uint32_t(image.levels[0].width);
+	header.height = uint32_t(image.levels[0].height);
+	header.pitchOrLinearSize = uint32_t(image.levels[0].data.size());
+	header.mipMapCount = uint32_t(image.levels.size());
+	header.version = TEXTURE_CACHE_VERSION;
+	header.sourceSize = stamp.size;
+	header.sourceMtime = stamp.mtime;
+	header.sourceHash = stamp.hash;
+	header.marker = TEXTURE_CACHE_MARKER;
+	header.pixelFormat.size = sizeof(DdsPixelFormat);
+	if (image.format == TextureFormat::RGBA8) {
+		header.pixelFormat.flags = DDPF_RGB | DDPF_ALPHAPIXELS;
+		header.pixelFormat.rgbBitCount = 32;
+		header.pixelFormat.masks[0] = 0x000000FF;
+		header.pixelFormat.masks[1] = 0x0000FF00;
+		header.pixelFormat.masks[2] = 0x00FF0000;
+		header.pixelFormat.masks[3] = 0xFF000000;
+	} else {
+		header.pixelFormat.flags = DDPF_FOURCC;
+		header.pixelFormat.fourCC = image.format == TextureFormat::BC1 ? DDS_FOURCC_DXT1 : DDS_FOURCC_DXT5;
+	}
+	header.caps[0] = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+	// Same temporary file and rename as the mesh caches
+	std::string tempFile = cacheFile + ".tmp";
+	{
+		std::ofstream out(tempFile, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const TextureLevel& level : image.levels)
+			out.write(reinterpret_cast<const char*>(level.data.data()), std::streamsize(level.data.size()));
+		if (!out)
+			return false;
+	}
+	std::remove(cacheFile.c_str());
+	return std::rename(tempFile.c_str(), cacheFile.c_str()) == 0;
+}
+
+bool loadTextureImage(const std::string& file, bool compress, TextureImage& image) {
+	FileStamp stamp;
+	if (!stampFile(file, stamp))
+		return false;
+	std::string cacheFile = file + TEXTURE_CACHE_EXTENSION;
+	image.cached = readTextureCache(cacheFile, stamp, image) && (image.format != TextureFormat::RGBA8) == compress;
+	if (image.cached)
+		return true;
+
+	int width, height;
+	uint8_t* pixels = stbi_load(file.c_str(), &width, &height, nullptr, STBI_rgb_alpha);
+	if (!pixels)
+		return false;
+	image.levels.clear();
+	image.levels.push_back({ width, height, std::vector<uint8_t>(pixels, pixels + size_t(4) * width * height) });
+	stbi_image_free(pixels);
+	image.format = TextureFormat::RGBA8;
+
+	auto start = std::chrono::steady_clock::now();
+	buildMipChain(image.levels);
+	image.mipMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (compress) {
+		// BC1 has no usable alpha here, BC3 spends twice the space on it
+		bool opaque = true;
+		const std::vector<uint8_t>& texels = image.levels[0].data;
+		for (size_t i = 3; i < texels.size() && opaque; i += 4)
+			opaque = texels[i] == 255;
+		image.format = opaque ? TextureFormat::BC1 : TextureFormat::BC3;
+		for (TextureLevel& level : image.levels) {
+			level.data = opaque ? compressBc1(level.data.data(), level.width, level.height)
+				: compressBc3(level.data.data(), level.width, level.height);
+		}
+	}
+
+	if (!writeTextureCache(cacheFile, stamp, image))
+		std::cerr << "Texture(" << file << "): cannot write cache " << cacheFile << std::endl;
+	return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "FileStamp.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Mip chain cached next to its source image as "<image>.dds", stamped like the mesh caches
+const char* const TEXTURE_CACHE_EXTENSION = ".dds";
+const uint32_t TEXTURE_CACHE_VERSION = 3;
+
+enum class TextureFormat : uint32_t {
+	RGBA8,
+	BC1,
+	BC3,
+};
+
+struct TextureLevel {
+	int width;
+	int height;
+	std::vector<uint8_t> data;
+};
+
+struct TextureImage {
+	TextureFormat format = TextureFormat::RGBA8;
+	// Level 0 first, down to 1x1
+	std::vector<TextureLevel> levels;
+	// Whether the image came from the cache rather than from its source
+	bool cached = false;
+	// Time spent building the mip chain, 0 when cached
+	double mipMs = 0;
+};
+
+// Reads the cache of `file`, or decodes it, builds its mip chain and caches the result.
+// With `compress` the levels are encoded to BC1 (opaque) or BC3, otherwise they stay in RGBA8. A cache written in
+// the other mode is rebuilt
+bool loadTextureImage(const std::string& file, bool compress, TextureImage& image);
+
+bool readTextureCache(const std::string& cacheFile, FileStamp& stamp, TextureImage& image);
+bool writeTextureCache(const std::string& cacheFile, FileStamp& stamp, const TextureImage& image);
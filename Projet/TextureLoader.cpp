@@ -0,0 +1,140 @@
+#include "TextureLoader.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+void TextureLoader::initialize(GLState& state, bool compress, unsigned threads) {
+	this->state = &state;
+	this->compress = compress;
+	if (threads == 0)
+		threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	this->stopping = false;
+	for (unsigned i = 0; i < threads; i++)
+		this->workers.emplace_back(&TextureLoader::work, this);
+}
+
+void TextureLoader::destroy() {
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopping = true;
+		this->jobs.clear();
+	}
+	this->wakeUp.notify_all();
+	for (std::thread& worker : this->workers)
+		worker.join();
+	this->workers.clear();
+	this->decoded.clear();
+}
+
+void TextureLoader::work() {
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->wakeUp.wait(lock, [this] {
+				return this->stopping || !this->jobs.empty();
+			});
+			if (this->stopping)
+				return;
+			job = std::move(this->jobs.front());
+			this->jobs.pop_front();
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		Decoded result = { job.texture, std::move(job.file), TextureImage() };
+		if (!loadTextureImage(result.file, this->compress, result.image))
+			result.image.levels.clear();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->decodeMs += ms;
+		if (result.image.mipMs > 0) {
+			this->mipMs += result.image.mipMs;
+			this->mipPixels += uint64_t(result.image.levels[0].width) * result.image.levels[0].height;
+		}
+		if (!this->stopping)
+			this->decoded.push_back(std::move(result));
+	}
+}
+
+GLuint TextureLoader::load(const std::string& file) {
+	if (!std::ifstream(file).good())
+		return 0;
+
+	// Mid-grey until the image is uploaded, complete without mipmaps
+	static const uint8_t PLACEHOLDER[4] = { 128, 128, 128, 255 };
+	GLuint texture;
+	glGenTextures(1, &texture);
+	this->state->bindTexture(0, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER);
+
+	if (this->requested == 0)
+		this->firstRequest = std::chrono::steady_clock::now();
+	this->requested++;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->jobs.push_back({ texture, file });
+	}
+	this->wakeUp.notify_one();
+	return texture;
+}
+
+void TextureLoader::upload(GLState& state, const Decoded& decoded) {
+	const TextureImage& image = decoded.image;
+	state.bindTexture(0, decoded.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	GLenum format = image.format == TextureFormat::BC1 ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(image.levels.size()) - 1);
+	for (size_t i = 0; i < image.levels.size(); i++) {
+		const TextureLevel& level = image.levels[i];
+		if (image.format == TextureFormat::RGBA8)
+			glTexImage2D(GL_TEXTURE_2D, GLint(i), GL_SRGB8_ALPHA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level.data.data());
+		else
+			glCompressedTexImage2D(GL_TEXTURE_2D, GLint(i), format, level.width, level.height, 0, GLsizei(level.data.size()), level.data.data());
+		this->textureBytes += level.data.size();
+		this->uncompressedBytes += uint64_t(4) * level.width * level.height;
+	}
+}
+
+uint32_t TextureLoader::update(GLState& state, double budgetMs) {
+	if (this->done())
+		return 0;
+	auto start = std::chrono::steady_clock::now();
+	uint32_t count = 0;
+	for (;;) {
+		Decoded result;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if (this->decoded.empty())
+				break;
+			result = std::move(this->decoded.back());
+			this->decoded.pop_back();
+		}
+
+		if (!result.image.levels.empty()) {
+			this->upload(state, result);
+			this->cached += result.image.cached;
+		} else {
+			std::cerr << "Failed to load texture: " << result.file << ", keeping its placeholder" << std::endl;
+		}
+		this->uploaded++;
+		count++;
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (ms >= budgetMs)
+			break;
+	}
+	this->uploadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (this->done()) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->firstRequest).count();
+		std::cout << "Textures: " << this->requested << " loaded in " << totalMs << " ms on " << this->workers.size() << " threads ("
+			<< this->decodeMs << " ms decoding, " << this->uploadMs << " ms uploading), " << this->cached << " from cache, "
+			<< this->textureBytes / 1024 << " KiB instead of " << this->uncompressedBytes / 1024 << " KiB uncompressed" << std::endl;
+		if (this->mipMs > 0)
+			std::cout << "Textures: mipmaps built at " << this->mipPixels / this->mipMs / 1000 << " Mpix/s" << std::endl;
+	}
+	return count;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GLState.h"
+#include "TextureCache.h"
+
+// Decodes textures with stb_image and builds their mip chain, or reads them from their cache, on worker threads while
+// the render thread keeps drawing.
+// load() returns the final texture name at once, showing a placeholder texel until update() uploads the image,
+// so that draws and batches built on the name never change
+struct TextureLoader {
+	struct Job {
+		GLuint texture;
+		std::string file;
+	};
+	struct Decoded {
+		GLuint texture;
+		std::string file;
+		// No level when loading failed
+		TextureImage image;
+	};
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::deque<Job> jobs;
+	std::vector<Decoded> decoded;
+	bool stopping = false;
+	// S3TC with sRGB decoding is available: mip chains are cached as BC1/BC3 rather than RGBA8
+	bool compress = false;
+
+	// Since initialize: decodeMs is summed over the workers, under `mutex`
+	uint32_t requested = 0;
+	uint32_t uploaded = 0;
+	double decodeMs = 0;
+	double uploadMs = 0;
+	uint32_t cached = 0;
+	// Mip chains built on the workers, in source pixels
+	double mipMs = 0;
+	uint64_t mipPixels = 0;
+	uint64_t textureBytes = 0;
+	uint64_t uncompressedBytes = 0;
+	std::chrono::steady_clock::time_point firstRequest;
+
+	// Placeholders are bound through it when created
+	GLState* state = nullptr;
+
+	// 0 threads: one per hardware thread, the render thread excepted
+	void initialize(GLState& state, bool compress, unsigned threads = 0);
+	// Joins the workers, pending images are dropped. Can be called again once they are joined
+	void destroy();
+
+	// Joins the workers left running by a failed initialization, so that they never outlive the loader
+	~TextureLoader() {
+		this->destroy();
+	}
+
+	// Returns 0 when the file does not exist
+	GLuint load(const std::string& file);
+	// Uploads decoded images until `budgetMs` is spent, at least one per call. Returns the number uploaded
+	uint32_t update(GLState& state, double budgetMs);
+	inline bool done() const {
+		return this->uploaded == this->requested;
+	}
+
+private:
+	void work();
+	void upload(GLState& state, const Decoded& decoded);
+};
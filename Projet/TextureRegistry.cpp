@@ -0,0 +1,99 @@
+#include "TextureRegistry.h"
+#include "FileStamp.h"
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+
+namespace {
+	// Empty when the file does not exist
+	std::string canonicalPath(const std::string& file) {
+#ifdef _WIN32
+		char path[_MAX_PATH];
+		return _fullpath(path, file.c_str(), _MAX_PATH) && std::ifstream(path).good() ? path : "";
+#else
+		char path[PATH_MAX];
+		return realpath(file.c_str(), path) ? path : "";
+#endif
+	}
+}
+
+GLuint TextureRegistry::acquire(const std::string& file) {
+	this->requests++;
+	std::string path = canonicalPath(file);
+	if (path.empty())
+		return 0;
+	auto known = this->byPath.find(path);
+	if (known != this->byPath.end()) {
+		Entry& entry = this->textures[known->second];
+		entry.references++;
+		this->savedBytes += entry.content.first;
+		return known->second;
+	}
+
+	FileStamp stamp;
+	if (!stampFile(path, stamp) || !hashFile(stamp))
+		return 0;
+	std::pair<uint64_t, uint64_t> content = { stamp.size, stamp.hash };
+	auto same = this->byContent.find(content);
+	if (same != this->byContent.end()) {
+		this->textures[same->second].references++;
+		this->byPath[path] = same->second;
+		this->savedBytes += stamp.size;
+		return same->second;
+	}
+
+	GLuint texture = this->loader->load(path);
+	if (!texture)
+		return 0;
+	Entry& entry = this->textures[texture];
+	entry.content = content;
+	entry.references = 1;
+	this->byPath[path] = texture;
+	this->byContent[content] = texture;
+	return texture;
+}
+
+void TextureRegistry::forget(GLuint texture) {
+	for (auto path = this->byPath.begin(); path != this->byPath.end();) {
+		if (path->second == texture)
+			path = this->byPath.erase(path);
+		else
+			++path;
+	}
+	// The content may already be loaded again under another name, after releaseImage
+	auto same = this->byContent.find(this->textures.at(texture).content);
+	if (same != this->byContent.end() && same->second == texture)
+		this->byContent.erase(same);
+}
+
+void TextureRegistry::release(GLuint texture) {
+	auto it = this->textures.find(texture);
+	if (it == this->textures.end() || --it->second.references > 0)
+		return;
+	this->forget(texture);
+	this->textures.erase(it);
+	this->loader->state->forgetTexture(texture);
+	glDeleteTextures(1, &texture);
+}
+
+void TextureRegistry::releaseImage(GLuint texture) {
+	if (!this->textures.count(texture))
+		return;
+	this->forget(texture);
+
+	// A single texel keeps the texture complete; empty levels free their memory
+	static const uint8_t PLACEHOLDER[4] = { 128, 128, 128, 255 };
+	GLint maxLevel;
+	this->loader->state->bindTexture(0, texture);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+	for (GLint level = 1; level <= maxLevel; level++) {
+		GLint width;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+		if (width == 0)
+			break;
+		glTexImage2D(GL_TEXTURE_2D, level, GL_SRGB8_ALPHA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include "TextureLoader.h"
+
+// Loads each image once and shares its texture name, like ShaderCache does for programs.
+// Images are matched by canonical path first, then by size and content hash, so copies under another name are
+// shared as well
+struct TextureRegistry {
+	struct Entry {
+		std::pair<uint64_t, uint64_t> content;
+		int references = 0;
+	};
+
+	TextureLoader* loader = nullptr;
+	std::map<GLuint, Entry> textures;
+	std::map<std::string, GLuint> byPath;
+	// (size, hash) of the image file
+	std::map<std::pair<uint64_t, uint64_t>, GLuint> byContent;
+
+	uint32_t requests = 0;
+	// Size of the image files that were not loaded again
+	uint64_t savedBytes = 0;
+
+	inline void initialize(TextureLoader& loader) {
+		this->loader = &loader;
+	}
+	// Returns 0 when the file does not exist
+	GLuint acquire(const std::string& file);
+	// Deletes the texture once its last user released it
+	void release(GLuint texture);
+	// For a texture whose users all sample a copy of it: frees its image but keeps the name until they release it.
+	// Later requests for the same file load the image again
+	void releaseImage(GLuint texture);
+
+	inline int references(GLuint texture) const {
+		auto it = this->textures.find(texture);
+		return it == this->textures.end() ? 0 : it->second.references;
+	}
+
+	inline size_t size() const {
+		return this->textures.size();
+	}
+
+private:
+	// Stops sharing the texture with new requests
+	void forget(GLuint texture);
+};
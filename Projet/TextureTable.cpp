@@ -0,0 +1,97 @@
+#include "TextureTable.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <tuple>
+
+void TextureTable::build(GLState& state, const std::vector<GLuint>& textures, bool bindless, GLuint handlesBinding) {
+	auto start = std::chrono::steady_clock::now();
+	if (bindless)
+		this->buildHandles(textures, handlesBinding);
+	else
+		this->buildArrays(state, textures);
+	this->buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (this->mode == BINDLESS)
+		std::cout << "Texture table: " << this->handles.size() << " resident handles";
+	else
+		std::cout << "Texture table: " << this->slots.size() << " textures copied into " << this->arrays.size() << " arrays of "
+			<< this->arrayBytes / 1024 << " KiB";
+	std::cout << " in " << this->buildMs << " ms" << std::endl;
+}
+
+void TextureTable::buildArrays(GLState& state, const std::vector<GLuint>& textures) {
+	// (width, height, levels, internal format)
+	using Shape = std::tuple<GLint, GLint, GLint, GLint>;
+	std::map<Shape, std::vector<GLuint>> shapes;
+	std::map<GLuint, uint64_t> sizes;
+	for (GLuint texture : textures) {
+		GLint width, height, format, maxLevel;
+		state.bindTexture(0, texture);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+		// Placeholders have a single level and keep the default GL_TEXTURE_MAX_LEVEL
+		GLint levels = 1;
+		while (levels <= maxLevel && std::max(width, height) >> levels)
+			levels++;
+		shapes[Shape(width, height, levels, format)].push_back(texture);
+
+		GLint compressed;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+		for (GLint level = 0; level < levels; level++) {
+			GLint size = 4 * std::max(1, width >> level) * std::max(1, height >> level);
+			if (compressed)
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+			sizes[texture] += uint64_t(size);
+		}
+	}
+
+	for (const auto& shape : shapes) {
+		GLint width = std::get<0>(shape.first), height = std::get<1>(shape.first), levels = std::get<2>(shape.first);
+		const std::vector<GLuint>& layers = shape.second;
+		GLuint array;
+		glGenTextures(1, &array);
+		state.bindTexture(0, array, GL_TEXTURE_2D_ARRAY);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GLenum(std::get<3>(shape.first)), width, height, GLsizei(layers.size()));
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		for (size_t layer = 0; layer < layers.size(); layer++) {
+			for (GLint level = 0; level < levels; level++) {
+				glCopyImageSubData(layers[layer], GL_TEXTURE_2D, level, 0, 0, 0, array, GL_TEXTURE_2D_ARRAY, level, 0, 0, GLint(layer),
+					std::max(1, width >> level), std::max(1, height >> level), 1);
+			}
+			this->slots[layers[layer]] = { array, uint32_t(layer), sizes[layers[layer]] };
+			this->arrayBytes += sizes[layers[layer]];
+		}
+		this->arrays.push_back(array);
+	}
+	this->mode = ARRAYS;
+}
+
+void TextureTable::buildHandles(const std::vector<GLuint>& textures, GLuint handlesBinding) {
+	for (GLuint texture : textures) {
+		GLuint64 handle = glGetTextureHandleARB(texture);
+		glMakeTextureHandleResidentARB(handle);
+		this->slots[texture] = { 0, uint32_t(this->handles.size()), 0 };
+		this->handles.push_back(handle);
+	}
+	glGenBuffers(1, &this->handleBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->handleBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(GLuint64) * this->handles.size()), this->handles.data(), GL_STATIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, handlesBinding, this->handleBuffer);
+	this->mode = BINDLESS;
+}
+
+void TextureTable::destroy() {
+	for (GLuint64 handle : this->handles)
+		glMakeTextureHandleNonResidentARB(handle);
+	glDeleteBuffers(1, &this->handleBuffer);
+	glDeleteTextures(GLsizei(this->arrays.size()), this->arrays.data());
+	this->handles.clear();
+	this->arrays.clear();
+	this->slots.clear();
+	this->handleBuffer = 0;
+	this->arrayBytes = 0;
+	this->mode = NONE;
+}
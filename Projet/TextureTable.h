@@ -0,0 +1,53 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "GLState.h"
+
+// Lets one multi-draw sample a different texture per draw, through an index stored with each draw.
+// With GL_ARB_bindless_texture the index selects a resident handle in a shader storage buffer. Otherwise the
+// textures are copied into GL_TEXTURE_2D_ARRAY layers, one array per (size, levels, format), and the index is the
+// layer: draws then only split between arrays
+struct TextureTable {
+	enum Mode {
+		// Nothing built, each draw binds its own texture
+		NONE,
+		ARRAYS,
+		BINDLESS,
+	};
+
+	struct Slot {
+		// Array holding the texture, 0 with bindless handles
+		GLuint array;
+		// Layer in the array, or index of the handle
+		uint32_t index;
+		// Size of all the levels copied into the array, 0 with bindless handles
+		uint64_t bytes;
+	};
+
+	Mode mode = NONE;
+	std::map<GLuint, Slot> slots;
+	std::vector<GLuint> arrays;
+	std::vector<GLuint64> handles;
+	GLuint handleBuffer = 0;
+	double buildMs = 0;
+	// Memory held by the arrays, as much again as the originals until their images are released
+	uint64_t arrayBytes = 0;
+
+	// The textures must be complete and no longer change: handles freeze their texture, arrays copy it.
+	// The handles are bound to `handlesBinding` once and for all. With arrays, an original whose users all sample it
+	// through its slot can give its image back with TextureRegistry::releaseImage
+	void build(GLState& state, const std::vector<GLuint>& textures, bool bindless, GLuint handlesBinding);
+	// Before the textures themselves are deleted
+	void destroy();
+
+	inline const Slot& slot(GLuint texture) const {
+		return this->slots.at(texture);
+	}
+
+private:
+	void buildArrays(GLState& state, const std::vector<GLuint>& textures);
+	void buildHandles(const std::vector<GLuint>& textures, GLuint handlesBinding);
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// Binding points shared with the `Frame` and `Object` blocks of the 3d shaders
+const unsigned int FRAME_UNIFORMS_BINDING = 0;
+const unsigned int OBJECT_UNIFORMS_BINDING = 1;
+// Shader storage binding of the `Draws` array of the *_indirect shaders
+const unsigned int DRAW_DATA_BINDING = 2;
+// Shader storage bindings of cull.cs.glsl
+const unsigned int CULL_DRAWS_BINDING = 3;
+const unsigned int CULLED_COMMANDS_BINDING = 4;
+const unsigned int DRAW_COUNTS_BINDING = 5;
+const unsigned int OCCLUDED_BINDING = 6;
+const unsigned int CULL_STATS_BINDING = 7;
+// Shader storage binding of the bindless `TextureHandles` of the *_indirect fragment shaders
+const unsigned int TEXTURE_HANDLES_BINDING = 8;
+
+// std140 mirror of the `Frame` block, uploaded once per frame
+struct FrameUniforms {
+	glm::mat4 viewProjection;
+	glm::vec3 view;
+	float time;
+	// Light struct, every vec3 member is padded to 16 bytes
+	glm::vec4 lightDirection;
+	glm::vec4 lightAmbientColor;
+	glm::vec4 lightDiffuseColor;
+	glm::vec4 lightSpecularColor;
+};
+static_assert(sizeof(FrameUniforms) == 144, "FrameUniforms must match the std140 Frame block");
+
+// std140 mirror of the `Object` block, one slice per drawn object
+struct ObjectUniforms {
+	glm::mat4 transform;
+	glm::mat4 transformNormal;
+};
+static_assert(sizeof(ObjectUniforms) == 128, "ObjectUniforms must match the std140 Object block");
+
+// std430 mirror of `DrawData`, one per indirect command, indexed by its baseInstance
+struct DrawData {
+	glm::mat4 transform;
+	glm::mat4 transformNormal;
+	glm::vec4 ambientColor;
+	glm::vec4 diffuseColor;
+	// w: shininess
+	glm::vec4 specularColor;
+	// Layer in the batch's texture array, or index of the bindless handle
+	uint32_t textureIndex;
+	uint32_t padding[3];
+};
+static_assert(sizeof(DrawData) == 192, "DrawData must match the std430 DrawData struct");
+
+// std430 mirror of `CullDraw`: local bounds of an indirect command and the command itself, instanceCount excepted
+struct CullDraw {
+	glm::vec3 boundsMin;
+	uint32_t batch;
+	glm::vec3 boundsMax;
+	// Index of the first command of the batch in the command buffer
+	uint32_t batchFirst;
+	uint32_t count;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;
+};
+static_assert(sizeof(CullDraw) == 48, "CullDraw must match the std430 CullDraw struct");
+
+// Model matrix of a placement (scale, then rotation of `angle` around Y, then translation) and its normal matrix
+inline ObjectUniforms makeObjectUniforms(const glm::vec3& scale, float angle, const glm::vec3& translation) {
+	glm::mat4 scaleMatrix = {
+			scale.x, 0, 0, 0,
+			0, scale.y, 0, 0,
+			0, 0, scale.z, 0,
+			0, 0, 0, 1,
+	};
+	glm::mat4 rotationMatrix = {
+			cos(angle), 0, sin(angle), 0,
+			0, 1, 0, 0,
+			-sin(angle), 0, cos(angle), 0,
+			0, 0, 0, 1,
+	};
+	glm::mat4 translationMatrix = {
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, 0,
+			translation.x, translation.y, translation.z, 1,
+	};
+	ObjectUniforms uniforms;
+	uniforms.transform = translationMatrix * rotationMatrix * scaleMatrix;
+	uniforms.transformNormal = glm::transpose(glm::inverse(uniforms.transform));
+	return uniforms;
+}
@@ -0,0 +1,171 @@
+#version 430
+
+// One invocation per indirect command: frustum and occlusion tests of its world box, then the command is written
+// with instanceCount 0 or 1 in place, or appended to its batch when `compact` is set and drawCounts are read back
+// by glMultiDrawElementsIndirectCount. Phase 2 writes to the second half of commands and drawCounts
+layout(local_size_x = 64) in;
+
+struct Light {
+    vec3 direction;
+    vec3 ambientColor;
+    vec3 diffuseColor;
+    vec3 specularColor;
+};
+
+layout(std140, binding = 0) uniform Frame {
+    mat4 viewProjection;
+    vec3 view;
+    float time;
+    Light light;
+};
+
+struct DrawData {
+    mat4 transform;
+    mat4 transformNormal;
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    // w: shininess
+    vec4 specularColor;
+    // Layer in textureArray, or index in textureHandles
+    uint textureIndex;
+};
+
+layout(std430, binding = 2) readonly buffer Draws {
+    DrawData draws[];
+};
+
+struct CullDraw {
+    vec3 boundsMin;
+    uint batch;
+    vec3 boundsMax;
+    uint batchFirst;
+    uint count;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 3) readonly buffer CullDraws {
+    CullDraw cullDraws[];
+};
+
+// DrawElementsIndirectCommand, 5 values each
+layout(std430, binding = 4) writeonly buffer Commands {
+    uint commands[];
+};
+
+layout(std430, binding = 5) buffer DrawCounts {
+    uint drawCounts[];
+};
+
+// Rejected by the depth pyramid in phase 1, to be re-tested in phase 2
+layout(std430, binding = 6) buffer Occluded {
+    uint occluded[];
+};
+
+// Accumulated over the frames until the CPU reads and clears them
+layout(std430, binding = 7) buffer CullStats {
+    uint frustumRejected;
+    uint occlusionRejected;
+    uint recovered;
+};
+
+uniform bool compact;
+// 0: frustum only. 1: also rejects the boxes hidden in the pyramid of a previous frame. 2: re-tests the boxes
+// rejected by phase 1 against the pyramid rebuilt from what phase 1 drew
+uniform int phase;
+uniform sampler2D pyramid;
+// Matrix the pyramid's depth was rendered with
+uniform mat4 pyramidViewProjection;
+
+bool isVisible(vec3 center, vec3 extent) {
+    // Gribb-Hartmann planes, not normalized since only the sign matters
+    for (int row = 0; row < 3; row++) {
+        for (int side = -1; side <= 1; side += 2) {
+            vec4 plane;
+            for (int column = 0; column < 4; column++)
+                plane[column] = viewProjection[column][3] + side * viewProjection[column][row];
+            if (dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extent) < 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool isOccluded(vec3 center, vec3 extent) {
+    vec3 ndcMin = vec3(1e30), ndcMax = vec3(-1e30);
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + extent * vec3((i & 1) != 0 ? 1 : -1, (i & 2) != 0 ? 1 : -1, (i & 4) != 0 ? 1 : -1);
+        vec4 clip = pyramidViewProjection * vec4(corner, 1);
+        // Crosses the near plane: no screen bounds
+        if (clip.w <= 0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+
+    // Level where the screen rectangle spans at most 2x2 texels
+    vec2 size = vec2(textureSize(pyramid, 0));
+    vec2 pixelMin = clamp(ndcMin.xy * 0.5 + 0.5, 0, 1) * size;
+    vec2 pixelMax = clamp(ndcMax.xy * 0.5 + 0.5, 0, 1) * size;
+    vec2 pixels = pixelMax - pixelMin;
+    int level = int(ceil(log2(max(max(pixels.x, pixels.y), 1))));
+    if (level >= textureQueryLevels(pyramid))
+        return false;
+    // Sizes and fetches with a level varying across invocations are not reliable everywhere (llvmpipe), hence
+    // the level size derived from level 0 and the nearest-filtered lookups at texel centers
+    ivec2 levelSize = max(ivec2(size) >> level, ivec2(1));
+    ivec2 texelMin = min(ivec2(pixelMin) >> level, levelSize - 1);
+    ivec2 texelMax = min(ivec2(pixelMax) >> level, levelSize - 1);
+    float depth = 0;
+    for (int y = texelMin.y; y <= texelMax.y; y++)
+        for (int x = texelMin.x; x <= texelMax.x; x++)
+            depth = max(depth, textureLod(pyramid, (vec2(x, y) + 0.5) / vec2(levelSize), float(level)).r);
+    return ndcMin.z * 0.5 + 0.5 > depth;
+}
+
+void main(void) {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= uint(cullDraws.length()))
+        return;
+    CullDraw draw = cullDraws[index];
+
+    // Box bounding the transformed local box (Arvo)
+    mat4 transform = draws[draw.baseInstance].transform;
+    vec3 localCenter = (draw.boundsMin + draw.boundsMax) * 0.5;
+    vec3 localExtent = (draw.boundsMax - draw.boundsMin) * 0.5;
+    vec3 center = (transform * vec4(localCenter, 1)).xyz;
+    vec3 extent = abs(transform[0].xyz) * localExtent.x + abs(transform[1].xyz) * localExtent.y + abs(transform[2].xyz) * localExtent.z;
+    bool visible;
+    if (phase == 2) {
+        visible = occluded[index] != 0u && !isOccluded(center, extent);
+        if (visible)
+            atomicAdd(recovered, 1u);
+    } else {
+        visible = isVisible(center, extent);
+        if (!visible)
+            atomicAdd(frustumRejected, 1u);
+        if (phase == 1) {
+            bool hidden = visible && isOccluded(center, extent);
+            occluded[index] = hidden ? 1u : 0u;
+            if (hidden)
+                atomicAdd(occlusionRejected, 1u);
+            visible = visible && !hidden;
+        }
+    }
+
+    uint commandBase = phase == 2 ? uint(cullDraws.length()) : 0u;
+    uint slot = commandBase + index;
+    if (compact) {
+        if (!visible)
+            return;
+        uint countBase = phase == 2 ? uint(drawCounts.length()) / 2u : 0u;
+        slot = commandBase + draw.batchFirst + atomicAdd(drawCounts[countBase + draw.batch], 1u);
+    }
+    commands[slot * 5 + 0] = draw.count;
+    commands[slot * 5 + 1] = visible ? 1u : 0u;
+    commands[slot * 5 + 2] = draw.firstIndex;
+    commands[slot * 5 + 3] = uint(draw.baseVertex);
+    commands[slot * 5 + 4] = draw.baseInstance;
+}
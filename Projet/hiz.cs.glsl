@@ -0,0 +1,33 @@
+#version 430
+
+// One level of the depth pyramid: a copy of the depth texture for level 0 (sourceLevel -1), otherwise the max of
+// the texels of the level above it. On odd sizes the last row and column also take the leftover texels, so that
+// a texel always covers every texel it maps to below
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D source;
+uniform int sourceLevel;
+layout(r32f, binding = 0) writeonly uniform image2D destination;
+
+void main(void) {
+    ivec2 size = imageSize(destination);
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, size)))
+        return;
+    if (sourceLevel < 0) {
+        imageStore(destination, texel, vec4(texelFetch(source, texel, 0).r));
+        return;
+    }
+
+    ivec2 sourceSize = textureSize(source, sourceLevel);
+    ivec2 last = ivec2(1);
+    if (texel.x == size.x - 1)
+        last.x = sourceSize.x - 1 - 2 * texel.x;
+    if (texel.y == size.y - 1)
+        last.y = sourceSize.y - 1 - 2 * texel.y;
+    float depth = 0;
+    for (int y = 0; y <= last.y; y++)
+        for (int x = 0; x <= last.x; x++)
+            depth = max(depth, texelFetch(source, 2 * texel + ivec2(x, y), sourceLevel).r);
+    imageStore(destination, texel, vec4(depth));
+}
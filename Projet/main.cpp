@@ -2,8 +2,28 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
+#include "Bvh.h"
+#include "Culling.h"
+#include "DepthPyramid.h"
 #include "GLShader.h"
+#include "GLState.h"
+#include "GeometryArena.h"
+#include "Mesh.h"
+#include "RenderQueue.h"
+#include "RingBuffer.h"
+#include "ShaderCache.h"
+#include "TextureLoader.h"
+#include "TextureRegistry.h"
+#include "TextureTable.h"
+#include "Uniforms.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <string>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #define TINYOBJLOADER_IMPLEMENTATION
@@ -24,17 +44,52 @@ struct Vertex2 {
     Color color;
     vec2 texCoords;
 };
-struct Vertex3 {
-	vec3 position;
-	vec3 normal;
-	vec2 texCoords;
-};
 
 const float PI = static_cast<float>(M_PI);
 const float DEG_TO_RAD = PI / 180;
 const float RAD_TO_DEG = 180 / PI;
 const float EPSILON = 0.01f;
 const float MOVEMENT_SPEED = 0.1f;
+const bool OPTIMIZE_MESHES = true;
+// Merge static meshes into one arena drawn with glMultiDrawElementsIndirect (needs OpenGL 4.3)
+const bool INDIRECT_DRAWS = true;
+// Side of the grid of instanced apples of `--apples`, 100 gives the 10k instances stress scene
+const int DEFAULT_APPLE_GRID_SIZE = 100;
+// Culls through the object hierarchy rather than testing every object box
+const bool BVH_CULLING = true;
+// With indirect draws, culls in a compute shader that writes the commands (falls back to CPU culling without it)
+const bool GPU_CULLING = true;
+// With GPU culling, also rejects the draws hidden in a depth pyramid of the previous frame
+const bool HIZ_OCCLUSION = true;
+// Time the render thread may spend per frame uploading textures decoded in the background
+const double TEXTURE_UPLOAD_BUDGET_MS = 2;
+// Cache textures as BC1/BC3 mip chains next to their image, when the driver decodes sRGB S3TC
+const bool COMPRESS_TEXTURES = true;
+// With indirect draws, once every texture is loaded, samples them through bindless handles or texture arrays so that
+// batches no longer split per texture
+const bool PACK_TEXTURES = true;
+// Unit of the texture array of a batch: a unit cannot feed both sampler_ and a sampler2DArray
+const GLuint TEXTURE_ARRAY_UNIT = 2;
+
+// Shader inputs, hashed at compile time and resolved through GLShader's reflection tables
+constexpr uint32_t A_POSITION = GLShader::Key("position");
+constexpr uint32_t A_NORMAL = GLShader::Key("normal");
+constexpr uint32_t A_COLOR = GLShader::Key("color");
+constexpr uint32_t A_TEX_COORDS = GLShader::Key("texCoords");
+constexpr uint32_t A_INSTANCE_TRANSFORM = GLShader::Key("instanceTransform");
+constexpr uint32_t A_INSTANCE_TRANSFORM_NORMAL = GLShader::Key("instanceTransformNormal");
+constexpr uint32_t U_TIME = GLShader::Key("time");
+constexpr uint32_t U_SAMPLER = GLShader::Key("sampler_");
+constexpr uint32_t U_TEXTURE_SOURCE = GLShader::Key("textureSource");
+constexpr uint32_t U_TEXTURE_ARRAY = GLShader::Key("textureArray");
+constexpr uint32_t U_MATERIAL_AMBIENT_COLOR = GLShader::Key("material.ambientColor");
+constexpr uint32_t U_MATERIAL_DIFFUSE_COLOR = GLShader::Key("material.diffuseColor");
+constexpr uint32_t U_MATERIAL_SPECULAR_COLOR = GLShader::Key("material.specularColor");
+constexpr uint32_t U_SHININESS = GLShader::Key("shininess");
+constexpr uint32_t U_COMPACT = GLShader::Key("compact");
+constexpr uint32_t U_PHASE = GLShader::Key("phase");
+constexpr uint32_t U_PYRAMID = GLShader::Key("pyramid");
+constexpr uint32_t U_PYRAMID_VIEW_PROJECTION = GLShader::Key("pyramidViewProjection");
 
 float cotan(float x) {
     return cos(x) / sin(x);
@@ -52,115 +107,103 @@ mat4 LookAt(vec3 position, vec3 target, vec3 up) {
 	};
 }
 
-struct Application;
+// MTL files often reference absolute paths or .dds files: only the file name is kept, and looked up (also as a
+// lowercase .png) next to the default texture, which is used when nothing matches
+std::string resolveTexture(const std::string& texname, const std::string& defaultTexture) {
+	if (texname.empty())
+		return defaultTexture;
+
+	size_t separator = texname.find_last_of("/\\");
+	std::string fileName = separator == std::string::npos ? texname : texname.substr(separator + 1);
+	std::string stem = fileName.substr(0, fileName.find_last_of('.'));
+	std::string lowerStem = stem;
+	std::transform(lowerStem.begin(), lowerStem.end(), lowerStem.begin(), [](char c) {
+		return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	});
+
+	size_t directoryEnd = defaultTexture.find_last_of("/\\");
+	std::string directory = directoryEnd == std::string::npos ? "" : defaultTexture.substr(0, directoryEnd + 1);
+	for (const std::string& candidate : { fileName, stem + ".png", lowerStem + ".png" })
+		if (std::ifstream(directory + candidate).good())
+			return directory + candidate;
+	return defaultTexture;
+}
 
-struct Obj {
-	Application& app;
-	GLShader shader;
-	GLuint buffers[3] = { 0, 0, 0 };
-	GLuint vao = 0;
-	GLuint texture = 0;
-	int numOfIndices = 0;
-	tinyobj::material_t material;
+// "3d.vs.glsl" -> "3d_indirect.vs.glsl": variant of a shader reading its inputs from the geometry arena
+std::string indirectVariant(const std::string& shaderFile) {
+	size_t stage = shaderFile.rfind(".", shaderFile.size() - sizeof(".glsl"));
+	return shaderFile.substr(0, stage) + "_indirect" + shaderFile.substr(stage);
+}
 
-	vec3 scale = { 1, 1, 1 };
-	float angle = 0;
-	vec3 translation = { 0, 0, 0 };
+// Range of the index buffer drawn with a single material
+struct ObjDraw {
+	tinyobj::material_t material;
+	GLuint texture;
+	GLsizei indexCount;
+	size_t indexOffset;
+	// Position in the geometry arena, for models stored there
+	GLuint firstIndex;
+	GLint baseVertex;
+};
 
-	explicit Obj(Application& app) : app(app) {}
+// GPU copy of an OBJ file, with its vertex layout for one program and one draw per material.
+// When given an arena, the geometry is appended to it instead and the model is drawn by indirect batches only
+struct Model {
+	GLuint buffers[2] = { 0, 0 };
+	glm::vec3 boundsMin = { 0, 0, 0 };
+	glm::vec3 boundsMax = { 0, 0, 0 };
+	GLuint vao = 0;
+	std::vector<GLuint> textures;
+	GLenum indexType = GL_UNSIGNED_INT;
+	std::vector<ObjDraw> draws;
 
-	void initialize(const char* shaderFileV, const char* shaderFileF, const std::string& objFile, const char* textureFile) {
-		this->shader.LoadVertexShader(shaderFileV);
-		this->shader.LoadFragmentShader(shaderFileF);
-		this->shader.Create();
+	void initialize(GLShader& shader, TextureRegistry& registry, const std::string& objFile, const char* textureFile, GeometryArena* arena = nullptr) {
+		Mesh mesh;
+		if (!mesh.loadCached(objFile, OPTIMIZE_MESHES))
+			exit(1);
 
-		tinyobj::ObjReader reader;
+		this->boundsMin = mesh.boundsMin;
+		this->boundsMax = mesh.boundsMax;
 
-		if (!reader.ParseFromFile(objFile)) {
-			if (!reader.Error().empty()) {
-				std::cerr << "TinyObjReader(" << objFile << "): " << reader.Error();
-			}
-			exit(1);
+		GLint baseVertex = 0;
+		GLuint firstIndex = 0;
+		if (arena) {
+			arena->add(mesh, baseVertex, firstIndex);
+			this->vao = arena->vao;
+		} else {
+			this->uploadBuffers(shader, mesh);
 		}
 
-		if (!reader.Warning().empty()) {
-			std::cout << "TinyObjReader(" << objFile << "): " << reader.Warning();
-		}
-
-		auto& attrib = reader.GetAttrib();
-		auto& shapes = reader.GetShapes();
-		auto& materials = reader.GetMaterials();
-
-		size_t verticesCount = 0;
-		for (const auto& shape : shapes)
-			for (const auto& num_face_vertice : shape.mesh.num_face_vertices)
-				verticesCount += size_t(num_face_vertice);
-		this->numOfIndices = int(verticesCount);
-		float objVertices[8 * verticesCount];
-		int objIndices[verticesCount];
-
-		size_t vertex_offset = 0;
-		size_t index_offset = 0;
-		// Loop over shapes
-		for (const auto& shape : shapes) {
-			// Loop over faces(polygon)
-			size_t shape_index_offset = 0;
-			for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-				auto fv = size_t(shape.mesh.num_face_vertices[f]);
-
-				// Loop over vertices in the face.
-				for (size_t v = 0; v < fv; v++) {
-					tinyobj::index_t idx = shape.mesh.indices[shape_index_offset + v];
-
-					// Vertex position
-					objVertices[8 * vertex_offset + 0] = attrib.vertices[3 * size_t(idx.vertex_index) + 0];
-					objVertices[8 * vertex_offset + 1] = attrib.vertices[3 * size_t(idx.vertex_index) + 2];
-					objVertices[8 * vertex_offset + 2] = -attrib.vertices[3 * size_t(idx.vertex_index) + 1];
-
-					// Check if `normal_index` is zero or positive. negative = no normal data
-					if (idx.normal_index >= 0) {
-						objVertices[8 * vertex_offset + 3] = attrib.normals[3 * size_t(idx.normal_index) + 0];
-						objVertices[8 * vertex_offset + 4] = attrib.normals[3 * size_t(idx.normal_index) + 2];
-						objVertices[8 * vertex_offset + 5] = -attrib.normals[3 * size_t(idx.normal_index) + 1];
-					}
-
-					// Check if `texcoord_index` is zero or positive. negative = no texcoord data
-					if (idx.texcoord_index >= 0) {
-						objVertices[8 * vertex_offset + 6] = attrib.texcoords[2 * size_t(idx.texcoord_index) + 0];
-						objVertices[8 * vertex_offset + 7] = attrib.texcoords[2 * size_t(idx.texcoord_index) + 1];
-					}
-
-					// Optional: vertex colors
-					// tinyobj::real_t r = attrib.colors[3 * size_t(idx.vertex_index) + 0];
-					// tinyobj::real_t g = attrib.colors[3 * size_t(idx.vertex_index) + 1];
-					// tinyobj::real_t b = attrib.colors[3 * size_t(idx.vertex_index) + 2];
-
-					objIndices[index_offset] = int(vertex_offset);
-
-					vertex_offset++;
-					index_offset++;
-				}
-				shape_index_offset += fv;
-
-				// per-face material
-				//const auto& material = materials[shape.mesh.material_ids[f]];
+		// One draw per material, all sharing the same buffers. Each draw holds a reference to its texture
+		size_t indexSize = this->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+		for (const Submesh& submesh : mesh.submeshes) {
+			const tinyobj::material_t& material = mesh.materials[submesh.materialId];
+			std::string materialTexture = resolveTexture(material.diffuse_texname, textureFile);
+			GLuint texture = registry.acquire(materialTexture);
+			if (!texture) {
+				std::cerr << "Failed to load texture: " << materialTexture;
+				exit(1);
 			}
+			this->textures.push_back(texture);
+			this->draws.push_back({ material, texture, GLsizei(submesh.indexCount), indexSize * submesh.firstIndex, firstIndex + submesh.firstIndex, baseVertex });
 		}
-		this->material = materials[0];
+	}
 
-		uint32_t prog = this->getProgram();
+	void uploadBuffers(GLShader& shader, const Mesh& mesh) {
+		this->indexType = mesh.hasShortIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		std::vector<uint8_t> packedIndices = mesh.packIndices();
 
-		glGenBuffers(3, this->buffers);
+		glGenBuffers(2, this->buffers);
 		glGenVertexArrays(1, &this->vao);
 
 		glBindVertexArray(this->vao);
 		glBindBuffer(GL_ARRAY_BUFFER, this->buffers[0]);
-		glBufferData(GL_ARRAY_BUFFER, 4 * 8 * GLsizeiptr(verticesCount), objVertices, GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(sizeof(Vertex3) * mesh.vertices.size()), mesh.vertices.data(), GL_STATIC_DRAW);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers[1]);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, 4 * GLsizeiptr(verticesCount), objIndices, GL_STATIC_DRAW);
-		const int32_t PROG_POSITION = glGetAttribLocation(prog, "position");
-		const int32_t PROG_NORMAL = glGetAttribLocation(prog, "normal");
-		const int32_t PROG_TEX_COORDS = glGetAttribLocation(prog, "texCoords");
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(packedIndices.size()), packedIndices.data(), GL_STATIC_DRAW);
+		const int32_t PROG_POSITION = shader.GetAttribute(A_POSITION);
+		const int32_t PROG_NORMAL = shader.GetAttribute(A_NORMAL);
+		const int32_t PROG_TEX_COORDS = shader.GetAttribute(A_TEX_COORDS);
 		glEnableVertexAttribArray(PROG_POSITION);
 		glEnableVertexAttribArray(PROG_NORMAL);
 		glEnableVertexAttribArray(PROG_TEX_COORDS);
@@ -171,46 +214,143 @@ struct Obj {
 		glBindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
 
-		//glBindBuffer(GL_UNIFORM_BUFFER, this->buffers[2]);
-		//glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(mat4), nullptr, GL_STREAM_DRAW);
-		//glBindBufferBase(GL_UNIFORM_BUFFER, 0, this->buffers[2]);
-		//glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	static void applyMaterial(GLShader& shader, const tinyobj::material_t& material) {
+		shader.SetVec3(U_MATERIAL_AMBIENT_COLOR, material.ambient);
+		shader.SetVec3(U_MATERIAL_DIFFUSE_COLOR, material.diffuse);
+		shader.SetVec3(U_MATERIAL_SPECULAR_COLOR, material.specular);
+		shader.SetFloat(U_SHININESS, material.shininess);
+	}
 
-		int w, h;
-		uint8_t* data = stbi_load(textureFile, &w, &h, nullptr, STBI_rgb_alpha);
-		if (!data) {
-			std::cerr << "Failed to load texture: " << textureFile;
-			exit(1);
+	// Expects the VAO and the program to be bound, returns the number of draw calls
+	uint32_t draw(GLState& state, GLShader& shader, GLsizei instanceCount, GLuint baseInstance) {
+		for (const ObjDraw& draw : this->draws) {
+			applyMaterial(shader, draw.material);
+			state.bindTexture(0, draw.texture);
+			if (instanceCount == 1 && baseInstance == 0)
+				glDrawElements(GL_TRIANGLES, draw.indexCount, this->indexType, (void*) draw.indexOffset);
+			else
+				glDrawElementsInstancedBaseInstance(GL_TRIANGLES, draw.indexCount, this->indexType, (void*) draw.indexOffset, instanceCount, baseInstance);
 		}
+		return uint32_t(this->draws.size());
+	}
+
+	void destroy(TextureRegistry& registry) {
+		// The arena owns the VAO of arena models
+		if (this->buffers[0])
+			glDeleteVertexArrays(1, &this->vao);
+		glDeleteBuffers(2, this->buffers);
+		for (GLuint texture : this->textures)
+			registry.release(texture);
+	}
+};
+
+// Commands of one (program, texture) bucket, contiguous in Application::indirectCommands. Once the textures are
+// packed, `texture` is the texture array of the bucket, or 0 with bindless handles
+struct IndirectBatch {
+	GLShader* shader;
+	GLuint texture;
+	GLintptr offset;
+	GLsizei count;
+};
+
+struct Application;
+
+struct Obj {
+	Application& app;
+	GLShader* shader = nullptr;
+	Model model;
+
+	vec3 scale = { 1, 1, 1 };
+	float angle = 0;
+	vec3 translation = { 0, 0, 0 };
 
-		glGenTextures(1, &this->texture);
-		glBindTexture(GL_TEXTURE_2D, this->texture);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+	explicit Obj(Application& app) : app(app) {}
+
+	void initialize(ShaderCache& shaders, TextureRegistry& registry, const char* shaderFileV, const char* shaderFileF, const std::string& objFile, const char* textureFile, GeometryArena* arena) {
+		if (arena)
+			this->shader = shaders.acquire(indirectVariant(shaderFileV).c_str(), nullptr, indirectVariant(shaderFileF).c_str());
+		else
+			this->shader = shaders.acquire(shaderFileV, nullptr, shaderFileF);
+		if (!this->shader)
+			exit(1);
+		this->model.initialize(*this->shader, registry, objFile, textureFile, arena);
+	}
+
+	ObjectUniforms uniforms() const {
+		return makeObjectUniforms(this->scale, this->angle, this->translation);
+	}
+
+	void destroy(ShaderCache& shaders, TextureRegistry& registry) {
+		this->model.destroy(registry);
+		shaders.release(this->shader);
+	}
+
+	inline uint32_t getProgram() {
+		return this->shader->GetProgram();
+	}
+};
+
+// Many placements of one model, drawn with a single instanced call per material.
+// Per-instance transforms live in a static buffer read as vertex attributes by 3d_instanced.vs.glsl
+struct InstancedObj {
+	Application& app;
+	GLShader* shader = nullptr;
+	Model model;
+	GLuint instanceBuffer = 0;
+	GLsizei instanceCount = 0;
+
+	explicit InstancedObj(Application& app) : app(app) {}
 
-		stbi_image_free(data);
+	void initialize(ShaderCache& shaders, TextureRegistry& registry, const char* shaderFileF, const std::string& objFile, const char* textureFile, const std::vector<ObjectUniforms>& instances) {
+		this->shader = shaders.acquire("3d_instanced.vs.glsl", nullptr, shaderFileF);
+		if (!this->shader)
+			exit(1);
+		this->model.initialize(*this->shader, registry, objFile, textureFile);
+		this->instanceCount = GLsizei(instances.size());
+
+		glGenBuffers(1, &this->instanceBuffer);
+		glBindVertexArray(this->model.vao);
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer);
+		glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(sizeof(ObjectUniforms) * instances.size()), instances.data(), GL_STATIC_DRAW);
+		// A mat4 attribute takes four consecutive locations, one per column
+		const int32_t PROG_INSTANCE_TRANSFORM = this->shader->GetAttribute(A_INSTANCE_TRANSFORM);
+		const int32_t PROG_INSTANCE_TRANSFORM_NORMAL = this->shader->GetAttribute(A_INSTANCE_TRANSFORM_NORMAL);
+		for (int column = 0; column < 4; column++) {
+			glEnableVertexAttribArray(PROG_INSTANCE_TRANSFORM + column);
+			glVertexAttribPointer(PROG_INSTANCE_TRANSFORM + column, 4, GL_FLOAT, GL_FALSE, sizeof(ObjectUniforms),
+				(void*) (offsetof(ObjectUniforms, transform) + column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(PROG_INSTANCE_TRANSFORM + column, 1);
+			glEnableVertexAttribArray(PROG_INSTANCE_TRANSFORM_NORMAL + column);
+			glVertexAttribPointer(PROG_INSTANCE_TRANSFORM_NORMAL + column, 4, GL_FLOAT, GL_FALSE, sizeof(ObjectUniforms),
+				(void*) (offsetof(ObjectUniforms, transformNormal) + column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(PROG_INSTANCE_TRANSFORM_NORMAL + column, 1);
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
 	void render();
 
-	void destroy() {
-		glDeleteBuffers(2, this->buffers);
-		glDeleteVertexArrays(1, &this->vao);
-		glDeleteTextures(1, &this->texture);
-		this->shader.Destroy();
+	void destroy(ShaderCache& shaders, TextureRegistry& registry) {
+		glDeleteBuffers(1, &this->instanceBuffer);
+		this->model.destroy(registry);
+		shaders.release(this->shader);
 	}
 
 	inline uint32_t getProgram() {
-		return this->shader.GetProgram();
+		return this->shader->GetProgram();
 	}
 };
 
 struct Application {
     int width;
     int height;
-	GLShader basicShader;
+	ShaderCache shaders;
+	TextureLoader textures;
+	TextureRegistry textureRegistry;
+	GLShader* basicShader = nullptr;
 	GLuint pausedBuffers[2] = { 0, 0 };
 	GLuint pausedVao = 0;
 	GLuint pausedTexture = 0;
@@ -228,6 +368,79 @@ struct Application {
 	GLFWcursor* handCursor = nullptr;
 
 	std::vector<Obj> objects;
+	std::vector<InstancedObj> instancedObjects;
+	// Side of the grid of instanced apples added to the scene, 0 for none
+	int appleGridSize = 0;
+	// Toggled with I: one instanced call per material, or one call per placement to compare
+	bool instancing = true;
+	// With `--compare-instancing`: frames drawn each way once the textures are loaded, before printing both and
+	// closing. The modes are indexed by `instancing`
+	uint32_t compareFrames = 0;
+	bool comparing = false;
+	uint32_t comparedDrawCalls[2] = {};
+	double comparedCpuMs[2] = {};
+	uint32_t drawCalls = 0;
+	double cpuMs = 0;
+	uint32_t statsFrames = 0;
+	GLState state;
+	// Every material range of every object, sorted each frame by the state it needs
+	struct QueuedDraw {
+		Obj* object;
+		const ObjDraw* draw;
+		GLintptr uniformsOffset;
+	};
+	RenderQueue queue;
+	std::vector<QueuedDraw> queuedDraws;
+	// Per-frame transforms and frustum test results of `objects`
+	std::vector<ObjectUniforms> objectUniforms;
+	CullingBoxes cullingBoxes;
+	std::vector<uint8_t> objectVisible;
+	double cullMs = 0;
+	uint64_t culledObjects = 0;
+	uint64_t testedObjects = 0;
+	// Hierarchy over the world boxes of `objects`, built once then refitted as objects move. Right click picks
+	Bvh bvh;
+	std::vector<vec3> worldMin;
+	std::vector<vec3> worldMax;
+	double bvhBuildMs = 0;
+	double refitMs = 0;
+	uint32_t refittedObjects = 0;
+	uint64_t bvhNodesVisited = 0;
+	bool pickRequested = false;
+	uint32_t programSwitches = 0;
+	uint32_t textureSwitches = 0;
+	uint32_t vaoSwitches = 0;
+	// Frame constants and one ObjectUniforms slice per object, rewritten every frame
+	RingBuffer uniformRing;
+	GLintptr frameUniformsOffset = 0;
+	std::vector<GLintptr> objectUniformsOffsets;
+	// Static objects merged into one arena and drawn by glMultiDrawElementsIndirect, one call per batch
+	bool indirect = false;
+	GeometryArena arena;
+	// Written every frame with instanceCount 0 for culled objects
+	std::vector<DrawElementsIndirectCommand> indirectCommands;
+	std::vector<uint32_t> indirectCommandObjects;
+	std::vector<IndirectBatch> indirectBatches;
+	// Per draw, in baseInstance order: its index in the texture table
+	std::vector<uint32_t> indirectTextureIndices;
+	GLuint indirectDrawCount = 0;
+	TextureTable textureTable;
+	RingBuffer drawRing;
+	// Commands written by cull.cs.glsl from the per-draw bounds, compacted per batch when the draw count can be
+	// read from a buffer (ARB_indirect_parameters)
+	bool gpuCulling = false;
+	bool drawCountBuffer = false;
+	GLShader cullShader;
+	GLuint cullDrawsBuffer = 0;
+	GLuint culledCommandsBuffer = 0;
+	GLuint drawCountsBuffer = 0;
+	std::vector<CullDraw> cullDraws;
+	// Hi-Z: draws rejected by the pyramid of the last frame are re-tested once it is rebuilt from this frame's
+	// first pass, and drawn by a second pass if they turn out visible
+	bool occlusion = false;
+	DepthPyramid pyramid;
+	GLuint occludedBuffer = 0;
+	GLuint cullStatsBuffer = 0;
 
     Application(int width, int height) : width(width), height(height) {}
 
@@ -249,35 +462,76 @@ struct Application {
         std::cout << "GLSL: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
         std::cout << "Extensions: " << glGetString(GL_EXTENSIONS) << std::endl;
 
-        this->basicShader.LoadVertexShader("basic.vs.glsl");
-        this->basicShader.LoadFragmentShader("basic.fs.glsl");
-        this->basicShader.Create();
-        uint32_t basic = this->getBasicProgram();
+        GLShader::SetBinaryCacheDirectory("shadercache");
+        this->basicShader = this->shaders.acquire("basic.vs.glsl", nullptr, "basic.fs.glsl");
+        if (!this->basicShader)
+            return false;
 
 		/* OBJECTS */
 
+		this->textures.initialize(this->state, COMPRESS_TEXTURES && GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB);
+		this->textureRegistry.initialize(this->textures);
+		this->indirect = INDIRECT_DRAWS && GLEW_VERSION_4_3;
+		if (this->indirect)
+			this->arena.initialize(this->state, 1 << 16, 1 << 18);
+		GeometryArena* arena = this->indirect ? &this->arena : nullptr;
+
 		Obj table(*this);
-		table.initialize("3d.vs.glsl", "3d.fs.glsl", "Obj/Meshes/dinertable.obj", "Obj/Textures/dinertable01_nv.png");
+		table.initialize(this->shaders, this->textureRegistry, "3d.vs.glsl", "3d.fs.glsl", "Obj/Meshes/dinertable.obj", "Obj/Textures/dinertable01_nv.png", arena);
 		table.translation = { 0, 0, 0 };
 		table.scale = { 0.5, 0.5, 0.5 };
 		this->objects.push_back(table);
 
 		Obj apple(*this);
-		apple.initialize("3d.vs.glsl", "3d_blink.fs.glsl", "Obj/Meshes/apple.obj", "Obj/Textures/apple.png");
+		apple.initialize(this->shaders, this->textureRegistry, "3d.vs.glsl", "3d_blink.fs.glsl", "Obj/Meshes/apple.obj", "Obj/Textures/apple.png", arena);
 		apple.translation = { 0, 34, 5 };
 		this->objects.push_back(apple);
 
 		Obj book(*this);
-		book.initialize("3d_shake.vs.glsl", "3d.fs.glsl", "Obj/Meshes/Book.obj", "Obj/Textures/bookgeneric01.png");
+		book.initialize(this->shaders, this->textureRegistry, "3d_shake.vs.glsl", "3d.fs.glsl", "Obj/Meshes/Book.obj", "Obj/Textures/bookgeneric01.png", arena);
 		book.translation = { 15, 29, 0 };
 		book.angle = 45;
 		this->objects.push_back(book);
 
 		Obj ragout(*this);
-		ragout.initialize("3d.vs.glsl", "3d.fs.glsl", "Obj/Meshes/ragout.obj", "Obj/Textures/ratstew.png");
+		ragout.initialize(this->shaders, this->textureRegistry, "3d.vs.glsl", "3d.fs.glsl", "Obj/Meshes/ragout.obj", "Obj/Textures/ratstew.png", arena);
 		ragout.translation = { -14, 30, -3 };
 		this->objects.push_back(ragout);
 
+		if (this->appleGridSize > 0) {
+			int side = this->appleGridSize;
+			std::vector<ObjectUniforms> placements;
+			for (int x = 0; x < side; x++)
+				for (int z = 0; z < side; z++)
+					placements.push_back(makeObjectUniforms({ 1, 1, 1 }, float(x * z), { (x - side / 2) * 4.f, 0, (z - side / 2) * 4.f }));
+			InstancedObj apples(*this);
+			apples.initialize(this->shaders, this->textureRegistry, "3d.fs.glsl", "Obj/Meshes/apple.obj", "Obj/Textures/apple.png", placements);
+			this->instancedObjects.push_back(apples);
+		}
+
+		std::cout << "Shaders: " << this->shaders.size() << " programs for " << this->shaders.requests << " requests" << std::endl;
+
+		/* UNIFORM BUFFERS */
+
+		GLint uniformAlignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		GLsizeiptr objectStride = (GLsizeiptr(sizeof(ObjectUniforms)) + uniformAlignment - 1) / uniformAlignment * uniformAlignment;
+		GLsizeiptr frameStride = (GLsizeiptr(sizeof(FrameUniforms)) + uniformAlignment - 1) / uniformAlignment * uniformAlignment;
+		if (!this->uniformRing.initialize(GL_UNIFORM_BUFFER, frameStride + objectStride * GLsizeiptr(this->objects.size()), uniformAlignment))
+			return false;
+		this->objectUniformsOffsets.resize(this->objects.size());
+		if (this->indirect) {
+			this->buildIndirectBatches();
+			GLint storageAlignment = 256;
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+			GLsizeiptr drawDataSize = GLsizeiptr(sizeof(DrawData) * this->indirectDrawCount);
+			GLsizeiptr commandsSize = GLsizeiptr(sizeof(DrawElementsIndirectCommand) * this->indirectCommands.size());
+			if (!this->drawRing.initialize(GL_SHADER_STORAGE_BUFFER, drawDataSize + storageAlignment + commandsSize, storageAlignment))
+				return false;
+			if (GPU_CULLING)
+				this->initializeGpuCulling();
+		}
+
 		/* PAUSED */
 
 		const Vertex2 pausedVertex[] = {
@@ -296,9 +550,9 @@ struct Application {
 		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex2) * 4, pausedVertex, GL_STATIC_DRAW);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->pausedBuffers[1]);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * 6, pausedIndices, GL_STATIC_DRAW);
-		const int32_t BASIC_POSITION = glGetAttribLocation(basic, "position");
-		const int32_t BASIC_COLOR = glGetAttribLocation(basic, "color");
-		const int32_t BASIC_TEX_COORDS = glGetAttribLocation(basic, "texCoords");
+		const int32_t BASIC_POSITION = this->basicShader->GetAttribute(A_POSITION);
+		const int32_t BASIC_COLOR = this->basicShader->GetAttribute(A_COLOR);
+		const int32_t BASIC_TEX_COORDS = this->basicShader->GetAttribute(A_TEX_COORDS);
 		glEnableVertexAttribArray(BASIC_POSITION);
 		glEnableVertexAttribArray(BASIC_COLOR);
 		glEnableVertexAttribArray(BASIC_TEX_COORDS);
@@ -309,19 +563,14 @@ struct Application {
 		glBindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		// The per-model and paused VAOs above were set up behind the tracker's back
+		this->state.invalidate();
 
-		int w, h;
-		uint8_t* data = stbi_load("paused.png", &w, &h, nullptr, STBI_rgb_alpha);
-		if (!data)
+		this->pausedTexture = this->textureRegistry.acquire("paused.png");
+		if (!this->pausedTexture)
 			return false;
-
-		glGenTextures(1, &this->pausedTexture);
-		glBindTexture(GL_TEXTURE_2D, this->pausedTexture);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		stbi_image_free(data);
+		std::cout << "Textures: " << this->textureRegistry.size() << " images for " << this->textureRegistry.requests << " requests, "
+			<< this->textureRegistry.savedBytes / 1024 << " KiB of image files not loaded twice" << std::endl;
 
 		/* GLFW CALLBACKS */
 
@@ -331,12 +580,27 @@ struct Application {
 				auto app = static_cast<Application*>(glfwGetWindowUserPointer(window));
 				app->canMove = !app->canMove;
 			}
+			// The counters restart with the mode, so that P never averages both
+			if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+				auto app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+				app->instancing = !app->instancing;
+				app->resetStats();
+				std::cout << (app->instancing ? "Instanced" : "Per placement") << " draws" << std::endl;
+			}
+			if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+				auto app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+				app->printStats();
+			}
 		});
 		glfwSetMouseButtonCallback(this->window, [](GLFWwindow* window, int button, int action, int mods) {
 			if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
 				auto app = static_cast<Application*>(glfwGetWindowUserPointer(window));
 				app->canMove = true;
 			}
+			if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
+				auto app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+				app->pickRequested = true;
+			}
 		});
 		glfwSetScrollCallback(this->window, [](GLFWwindow* window, double xoffset, double yoffset) {
 			auto app = static_cast<Application*>(glfwGetWindowUserPointer(window));
@@ -345,29 +609,309 @@ struct Application {
 		});
 		glfwGetCursorPos(this->window, &this->lastMouseX, &this->lastMouseY);
 		this->canMove = true;
+		std::cout << "Keys: P prints the frame statistics, I toggles instancing, Escape pauses" << std::endl;
 
 		return true;
     }
 
+	// Buckets every draw of every object by (program, texture), or by (program, texture array) once the textures are
+	// packed. Draw i gets baseInstance i, which the shaders use to index this frame's DrawData array
+	void buildIndirectBatches() {
+		this->indirectCommands.clear();
+		this->indirectCommandObjects.clear();
+		this->indirectBatches.clear();
+		this->indirectTextureIndices.clear();
+		this->cullDraws.clear();
+		struct Bucket {
+			GLShader* shader;
+			std::vector<DrawElementsIndirectCommand> commands;
+			std::vector<uint32_t> objects;
+		};
+		std::map<std::pair<GLuint, GLuint>, Bucket> buckets;
+		GLuint drawIndex = 0;
+		for (size_t i = 0; i < this->objects.size(); i++) {
+			Obj& object = this->objects[i];
+			for (const ObjDraw& draw : object.model.draws) {
+				GLuint texture = draw.texture;
+				uint32_t textureIndex = 0;
+				if (this->textureTable.mode != TextureTable::NONE) {
+					texture = this->textureTable.slot(draw.texture).array;
+					textureIndex = this->textureTable.slot(draw.texture).index;
+				}
+				this->indirectTextureIndices.push_back(textureIndex);
+				Bucket& bucket = buckets[{ object.getProgram(), texture }];
+				bucket.shader = object.shader;
+				bucket.commands.push_back({ GLuint(draw.indexCount), 1, draw.firstIndex, draw.baseVertex, drawIndex++ });
+				bucket.objects.push_back(uint32_t(i));
+			}
+		}
+		this->indirectDrawCount = drawIndex;
+		this->arena.reserveDraws(drawIndex);
+
+		for (auto& bucket : buckets) {
+			uint32_t batchFirst = uint32_t(this->indirectCommands.size());
+			for (size_t i = 0; i < bucket.second.commands.size(); i++) {
+				const DrawElementsIndirectCommand& command = bucket.second.commands[i];
+				const Model& model = this->objects[bucket.second.objects[i]].model;
+				this->cullDraws.push_back({ model.boundsMin, uint32_t(this->indirectBatches.size()), model.boundsMax, batchFirst,
+					command.count, command.firstIndex, command.baseVertex, command.baseInstance });
+			}
+			GLintptr offset = GLintptr(this->indirectCommands.size() * sizeof(DrawElementsIndirectCommand));
+			this->indirectBatches.push_back({ bucket.second.shader, bucket.first.second, offset, GLsizei(bucket.second.commands.size()) });
+			this->indirectCommands.insert(this->indirectCommands.end(), bucket.second.commands.begin(), bucket.second.commands.end());
+			this->indirectCommandObjects.insert(this->indirectCommandObjects.end(), bucket.second.objects.begin(), bucket.second.objects.end());
+		}
+		std::cout << "Indirect: " << drawIndex << " draws in " << this->indirectBatches.size() << " batches, arena of "
+			<< this->arena.vertexCount << " vertices and " << this->arena.indexCount << " indices" << std::endl;
+	}
+
+	// Once every texture is loaded: nothing changes them anymore, so they can be frozen into handles or copied
+	void packTextures() {
+		std::vector<GLuint> textures;
+		for (const Obj& object : this->objects)
+			for (const ObjDraw& draw : object.model.draws)
+				textures.push_back(draw.texture);
+		std::sort(textures.begin(), textures.end());
+		textures.erase(std::unique(textures.begin(), textures.end()), textures.end());
+		this->textureTable.build(this->state, textures, GLEW_ARB_bindless_texture != 0, TEXTURE_HANDLES_BINDING);
+		if (this->textureTable.mode == TextureTable::ARRAYS)
+			this->releasePackedImages();
+
+		this->buildIndirectBatches();
+		if (this->gpuCulling) {
+			this->state.bindBuffer(GL_SHADER_STORAGE_BUFFER, this->cullDrawsBuffer);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(sizeof(CullDraw) * this->cullDraws.size()), this->cullDraws.data());
+			// The flags of the last frame belong to the old order, every draw is tested again from scratch
+			this->state.bindBuffer(GL_SHADER_STORAGE_BUFFER, this->occludedBuffer);
+			glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		}
+	}
+
+	// Arrays are copies: an original only referenced by indirect draws is never sampled again, while instanced
+	// objects and the pause screen keep binding theirs
+	void releasePackedImages() {
+		std::map<GLuint, int> indirectReferences;
+		for (const Obj& object : this->objects)
+			for (const ObjDraw& draw : object.model.draws)
+				indirectReferences[draw.texture]++;
+		uint32_t released = 0;
+		uint64_t releasedBytes = 0;
+		for (const auto& texture : indirectReferences) {
+			if (this->textureRegistry.references(texture.first) != texture.second)
+				continue;
+			this->textureRegistry.releaseImage(texture.first);
+			released++;
+			releasedBytes += this->textureTable.slot(texture.first).bytes;
+		}
+		std::cout << "Texture table: " << released << " of " << indirectReferences.size() << " originals released ("
+			<< releasedBytes / 1024 << " KiB), the others are still bound outside the arrays" << std::endl;
+	}
+
+	// Sampler setup of an indirect batch; the mode values are the textureSource of the *_indirect shaders
+	void bindBatchTexture(const IndirectBatch& batch) {
+		batch.shader->SetInt(U_SAMPLER, 0);
+		batch.shader->SetInt(U_TEXTURE_ARRAY, TEXTURE_ARRAY_UNIT);
+		batch.shader->SetInt(U_TEXTURE_SOURCE, this->textureTable.mode);
+		if (this->textureTable.mode == TextureTable::NONE)
+			this->textureSwitches += this->state.bindTexture(0, batch.texture);
+		else if (this->textureTable.mode == TextureTable::ARRAYS)
+			this->textureSwitches += this->state.bindTexture(TEXTURE_ARRAY_UNIT, batch.texture, GL_TEXTURE_2D_ARRAY);
+	}
+
+	// Compute shaders are core since 4.3 like indirect draws, but the program may still fail to build
+	void initializeGpuCulling() {
+		if (!this->cullShader.LoadComputeShader("cull.cs.glsl") || !this->cullShader.Create()) {
+			std::cerr << "GPU culling: cannot build cull.cs.glsl, culling on the CPU" << std::endl;
+			this->cullShader.Destroy();
+			return;
+		}
+		this->gpuCulling = true;
+		this->drawCountBuffer = GLEW_ARB_indirect_parameters != 0;
+
+		GLuint buffers[5];
+		glGenBuffers(5, buffers);
+		this->cullDrawsBuffer = buffers[0];
+		this->culledCommandsBuffer = buffers[1];
+		this->drawCountsBuffer = buffers[2];
+		this->occludedBuffer = buffers[3];
+		this->cullStatsBuffer = buffers[4];
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->cullDrawsBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(CullDraw) * this->cullDraws.size(), this->cullDraws.data(), GL_STATIC_DRAW);
+		// Second halves for the second pass
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->culledCommandsBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(DrawElementsIndirectCommand) * this->cullDraws.size(), nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->drawCountsBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint) * this->indirectBatches.size(), nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->occludedBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * this->cullDraws.size(), nullptr, GL_DYNAMIC_COPY);
+		const GLuint noStats[4] = {};
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->cullStatsBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(noStats), noStats, GL_DYNAMIC_COPY);
+		this->occlusion = HIZ_OCCLUSION && this->pyramid.initialize();
+		std::cout << "GPU culling: " << this->cullDraws.size() << " draws, "
+			<< (this->drawCountBuffer ? "compacted with a draw count" : "culled draws kept with instanceCount 0")
+			<< (this->occlusion ? ", Hi-Z occlusion" : "") << std::endl;
+	}
+
+	// A constant number of calls whatever the scene size: per pass, one dispatch then one draw per batch
+	void renderGpuCulled() {
+		bool retest = this->occlusion && this->pyramid.valid;
+		this->cullOnGpu(retest ? 1 : 0);
+		this->drawGpuCulled(0);
+		if (!this->occlusion)
+			return;
+		this->pyramid.build(this->state, this->projection * this->camera);
+		if (retest) {
+			this->cullOnGpu(2);
+			this->drawGpuCulled(1);
+		}
+	}
+
+	void cullOnGpu(int phase) {
+		GLsizeiptr cullDrawsSize = GLsizeiptr(sizeof(CullDraw) * this->cullDraws.size());
+		GLsizeiptr commandsSize = GLsizeiptr(2 * sizeof(DrawElementsIndirectCommand) * this->cullDraws.size());
+		GLsizeiptr drawCountsSize = GLsizeiptr(2 * sizeof(GLuint) * this->indirectBatches.size());
+		if (this->drawCountBuffer) {
+			// Only the counts of this pass
+			GLintptr countsOffset = phase == 2 ? drawCountsSize / 2 : 0;
+			this->state.bindBuffer(GL_SHADER_STORAGE_BUFFER, this->drawCountsBuffer);
+			glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, countsOffset, drawCountsSize / 2, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		}
+		this->state.bindBufferRange(GL_SHADER_STORAGE_BUFFER, CULL_DRAWS_BINDING, this->cullDrawsBuffer, 0, cullDrawsSize);
+		this->state.bindBufferRange(GL_SHADER_STORAGE_BUFFER, CULLED_COMMANDS_BINDING, this->culledCommandsBuffer, 0, commandsSize);
+		this->state.bindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_COUNTS_BINDING, this->drawCountsBuffer, 0, drawCountsSize);
+		this->state.bindBufferRange(GL_SHADER_STORAGE_BUFFER, OCCLUDED_BINDING, this->occludedBuffer, 0, GLsizeiptr(sizeof(GLuint) * this->cullDraws.size()));
+		this->state.bindBufferRange(GL_SHADER_STORAGE_BUFFER, CULL_STATS_BINDING, this->cullStatsBuffer, 0, 4 * sizeof(GLuint));
+		this->programSwitches += this->state.useProgram(this->cullShader.GetProgram());
+		this->cullShader.SetInt(U_COMPACT, this->drawCountBuffer);
+		this->cullShader.SetInt(U_PHASE, phase);
+		if (phase != 0) {
+			this->textureSwitches += this->state.bindTexture(1, this->pyramid.texture);
+			this->cullShader.SetInt(U_PYRAMID, 1);
+			this->cullShader.SetMat4(U_PYRAMID_VIEW_PROJECTION, glm::value_ptr(this->pyramid.viewProjection));
+		}
+		glDispatchCompute(GLuint(this->cullDraws.size() + 63) / 64, 1, 1);
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	void drawGpuCulled(int pass) {
+		GLintptr commandsBase = GLintptr(pass * sizeof(DrawElementsIndirectCommand) * this->cullDraws.size());
+		GLintptr countsBase = GLintptr(pass * sizeof(GLuint) * this->indirectBatches.size());
+		this->vaoSwitches += this->state.bindVertexArray(this->arena.vao);
+		this->state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, this->culledCommandsBuffer);
+		if (this->drawCountBuffer)
+			this->state.bindBuffer(GL_PARAMETER_BUFFER_ARB, this->drawCountsBuffer);
+		for (size_t i = 0; i < this->indirectBatches.size(); i++) {
+			const IndirectBatch& batch = this->indirectBatches[i];
+			this->programSwitches += this->state.useProgram(batch.shader->GetProgram());
+			this->bindBatchTexture(batch);
+			void* commands = (void*) (commandsBase + batch.offset);
+			if (this->drawCountBuffer)
+				glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, commands, countsBase + GLintptr(i * sizeof(GLuint)), batch.count, 0);
+			else
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, commands, batch.count, 0);
+			this->drawCalls++;
+		}
+	}
+
+	void renderIndirect() {
+		void* data;
+		GLsizeiptr drawDataSize = GLsizeiptr(sizeof(DrawData) * this->indirectDrawCount);
+		GLintptr drawDataOffset = this->drawRing.allocate(drawDataSize, &data);
+		// Skipped this frame, the ring grows for the next one
+		if (drawDataOffset < 0)
+			return;
+		DrawData* drawData = static_cast<DrawData*>(data);
+		const uint32_t* textureIndex = this->indirectTextureIndices.data();
+		for (size_t i = 0; i < this->objects.size(); i++) {
+			const ObjectUniforms& uniforms = this->objectUniforms[i];
+			for (const ObjDraw& draw : this->objects[i].model.draws) {
+				drawData->transform = uniforms.transform;
+				drawData->transformNormal = uniforms.transformNormal;
+				drawData->ambientColor = glm::vec4(glm::make_vec3(draw.material.ambient), 0);
+				drawData->diffuseColor = glm::vec4(glm::make_vec3(draw.material.diffuse), 0);
+				drawData->specularColor = glm::vec4(glm::make_vec3(draw.material.specular), draw.material.shininess);
+				drawData->textureIndex = *textureIndex++;
+				drawData++;
+			}
+		}
+		if (this->gpuCulling) {
+			this->drawRing.flush();
+			this->state.bindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, this->drawRing.buffer, drawDataOffset, drawDataSize);
+			this->renderGpuCulled();
+			return;
+		}
+		GLsizeiptr commandsSize = GLsizeiptr(sizeof(DrawElementsIndirectCommand) * this->indirectCommands.size());
+		GLintptr commandsOffset = this->drawRing.allocate(commandsSize, &data);
+		if (commandsOffset < 0)
+			return;
+		DrawElementsIndirectCommand* commands = static_cast<DrawElementsIndirectCommand*>(data);
+		for (size_t i = 0; i < this->indirectCommands.size(); i++) {
+			commands[i] = this->indirectCommands[i];
+			commands[i].instanceCount = this->objectVisible[this->indirectCommandObjects[i]];
+		}
+		this->drawRing.flush();
+		this->state.bindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, this->drawRing.buffer, drawDataOffset, drawDataSize);
+
+		this->vaoSwitches += this->state.bindVertexArray(this->arena.vao);
+		this->state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, this->drawRing.buffer);
+		for (const IndirectBatch& batch : this->indirectBatches) {
+			this->programSwitches += this->state.useProgram(batch.shader->GetProgram());
+			this->bindBatchTexture(batch);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*) (commandsOffset + batch.offset), batch.count, 0);
+			this->drawCalls++;
+		}
+	}
+
+	void renderQueue(float far) {
+		this->queue.clear();
+		this->queuedDraws.clear();
+		for (size_t i = 0; i < this->objects.size(); i++) {
+			// Objects whose uniforms did not fit in the ring are left out
+			if (!this->objectVisible[i] || this->objectUniformsOffsets[i] < 0)
+				continue;
+			Obj& object = this->objects[i];
+			float depth = glm::distance(this->cameraPosition, object.translation) / far;
+			for (const ObjDraw& draw : object.model.draws) {
+				this->queue.push(RenderQueue::makeKey(0, object.getProgram(), draw.texture, object.model.vao, depth), uint32_t(this->queuedDraws.size()));
+				this->queuedDraws.push_back({ &object, &draw, this->objectUniformsOffsets[i] });
+			}
+		}
+		this->queue.sort();
+
+		for (const RenderItem& item : this->queue.items) {
+			const QueuedDraw& queued = this->queuedDraws[item.index];
+			Obj& object = *queued.object;
+			GLShader& shader = *object.shader;
+			this->programSwitches += this->state.useProgram(object.getProgram());
+			shader.SetInt(U_SAMPLER, 0);
+			this->state.bindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORMS_BINDING, this->uniformRing.buffer, queued.uniformsOffset, sizeof(ObjectUniforms));
+			this->vaoSwitches += this->state.bindVertexArray(object.model.vao);
+			this->textureSwitches += this->state.bindTexture(0, queued.draw->texture);
+			Model::applyMaterial(shader, queued.draw->material);
+			glDrawElements(GL_TRIANGLES, queued.draw->indexCount, object.model.indexType, (void*) queued.draw->indexOffset);
+			this->drawCalls++;
+		}
+	}
+
 	void renderPaused() {
-		uint32_t basic = this->getBasicProgram();
-		glUseProgram(basic);
-
-		const int32_t BASIC_TIME = glGetUniformLocation(basic, "time");
-		const int32_t BASIC_SAMPLER = glGetUniformLocation(basic, "sampler_");
-		glUniform1f(BASIC_TIME, 0);
-		glUniform1i(BASIC_SAMPLER, 0);
-
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, this->pausedTexture);
-		glBindVertexArray(this->pausedVao);
+		this->programSwitches += this->state.useProgram(this->getBasicProgram());
+		this->basicShader->SetFloat(U_TIME, 0);
+		this->basicShader->SetInt(U_SAMPLER, 0);
+
+		this->state.setEnabled(GL_BLEND, true);
+		this->state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		this->textureSwitches += this->state.bindTexture(0, this->pausedTexture);
+		this->vaoSwitches += this->state.bindVertexArray(this->pausedVao);
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-		glDisable(GL_BLEND);
+		this->state.setEnabled(GL_BLEND, false);
 	}
 
     void render() {
+		auto frameStart = std::chrono::steady_clock::now();
+		this->textures.update(this->state, TEXTURE_UPLOAD_BUDGET_MS);
+		if (this->indirect && PACK_TEXTURES && this->textureTable.mode == TextureTable::NONE && this->textures.done())
+			this->packTextures();
 		bool clicked = glfwGetMouseButton(this->window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
 		glfwSetCursor(this->window, clicked ? this->handCursor : nullptr);
 
@@ -427,106 +971,310 @@ struct Application {
 		this->cameraPosition = this->target + rawCameraPosition;
 		this->camera = LookAt(this->cameraPosition, this->target, { 0, 1, 0 });
 
+		/* CULLING */
+
+		auto cullStart = std::chrono::steady_clock::now();
+		this->objectUniforms.resize(this->objects.size());
+		this->objectVisible.resize(this->objects.size());
+		this->cullingBoxes.resize(this->objects.size());
+		for (size_t i = 0; i < this->objects.size(); i++) {
+			const Obj& object = this->objects[i];
+			this->objectUniforms[i] = object.uniforms();
+			this->cullingBoxes.set(i, object.model.boundsMin, object.model.boundsMax, this->objectUniforms[i].transform);
+		}
+		Frustum frustum = Frustum::fromMatrix(this->projection * this->camera);
+		size_t visibleCount;
+		if (this->gpuCulling) {
+			// Only kept up to date for picking
+			if (BVH_CULLING)
+				this->updateBvh();
+			visibleCount = this->objects.size();
+		} else if (BVH_CULLING) {
+			this->updateBvh();
+			uint32_t nodesVisited = 0;
+			visibleCount = this->bvh.cullFrustum(frustum, this->objectVisible.data(), nodesVisited);
+			this->bvhNodesVisited += nodesVisited;
+		} else {
+			visibleCount = cullBoxes(frustum, this->cullingBoxes, this->objectVisible.data());
+		}
+		this->culledObjects += this->objects.size() - visibleCount;
+		this->testedObjects += this->gpuCulling ? 0 : this->objects.size();
+		this->cullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+
+		if (this->pickRequested) {
+			this->pickRequested = false;
+			this->pick(mouseX, mouseY);
+		}
+
+		/* UNIFORMS */
+
+		GLuint uniformBuffer = this->uniformRing.buffer;
+		if (this->uniformRing.beginFrame())
+			this->state.forgetBuffer(uniformBuffer);
+		GLuint drawBuffer = this->drawRing.buffer;
+		if (this->indirect && this->drawRing.beginFrame())
+			this->state.forgetBuffer(drawBuffer);
+		void* data;
+		this->frameUniformsOffset = this->uniformRing.allocate(sizeof(FrameUniforms), &data);
+		// Only when the region cannot hold a single block: the frame is lost, the ring grows for the next one
+		if (this->frameUniformsOffset < 0) {
+			this->uniformRing.endFrame();
+			if (this->indirect)
+				this->drawRing.endFrame();
+			return;
+		}
+		FrameUniforms& frame = *static_cast<FrameUniforms*>(data);
+		frame.viewProjection = this->projection * this->camera;
+		frame.view = this->cameraPosition;
+		frame.time = static_cast<float>(glfwGetTime());
+		frame.lightDirection = { 1, -1, -1, 0 };
+		frame.lightAmbientColor = { 0.1, 0.1, 0.1, 0 };
+		frame.lightDiffuseColor = { 1, 1, 1, 0 };
+		frame.lightSpecularColor = { 0.5, 0.5, 0.5, 0 };
+
+		for (size_t i = 0; i < this->objects.size() && !this->indirect; i++) {
+			if (!this->objectVisible[i])
+				continue;
+			this->objectUniformsOffsets[i] = this->uniformRing.allocate(sizeof(ObjectUniforms), &data);
+			if (data)
+				*static_cast<ObjectUniforms*>(data) = this->objectUniforms[i];
+		}
+		this->uniformRing.flush();
+		this->state.bindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, this->uniformRing.buffer, this->frameUniformsOffset, sizeof(FrameUniforms));
+
 		/* DRAW */
 
 		glClearColor(0, 0, 0, 1);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		for (Obj& object : this->objects)
+		if (this->indirect) {
+			this->renderIndirect();
+		} else {
+			this->renderQueue(far);
+		}
+		for (InstancedObj& object : this->instancedObjects)
 			object.render();
 
 		if (!this->canMove)
 			this->renderPaused();
+
+		this->uniformRing.endFrame();
+		if (this->indirect)
+			this->drawRing.endFrame();
+
+		this->cpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+		this->statsFrames++;
+		if (this->compareFrames > 0)
+			this->updateComparison();
+	}
+
+	// Instanced first, then per placement; texture uploads are over before the first counted frame
+	void updateComparison() {
+		if (!this->comparing) {
+			if (!this->textures.done())
+				return;
+			this->comparing = true;
+			this->instancing = true;
+			this->resetStats();
+			return;
+		}
+		if (this->statsFrames < this->compareFrames)
+			return;
+		this->comparedDrawCalls[this->instancing] = this->drawCalls / this->statsFrames;
+		this->comparedCpuMs[this->instancing] = this->cpuMs / this->statsFrames;
+		this->printStats();
+		if (this->instancing) {
+			this->instancing = false;
+			return;
+		}
+		std::cout << "Instancing comparison over " << this->compareFrames << " frames: instanced " << this->comparedDrawCalls[1]
+			<< " draw calls and " << this->comparedCpuMs[1] << " ms CPU per frame, per placement " << this->comparedDrawCalls[0]
+			<< " draw calls and " << this->comparedCpuMs[0] << " ms CPU per frame" << std::endl;
+		this->compareFrames = 0;
+		glfwSetWindowShouldClose(this->window, GLFW_TRUE);
+	}
+
+	// World boxes come from the culling boxes; the hierarchy is built on the first frame and only the objects
+	// whose box changed are refitted afterwards
+	void updateBvh() {
+		size_t count = this->objects.size();
+		bool rebuild = this->worldMin.size() != count;
+		this->worldMin.resize(count);
+		this->worldMax.resize(count);
+		auto refitStart = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < count; i++) {
+			vec3 center = { this->cullingBoxes.centerX[i], this->cullingBoxes.centerY[i], this->cullingBoxes.centerZ[i] };
+			vec3 extent = { this->cullingBoxes.extentX[i], this->cullingBoxes.extentY[i], this->cullingBoxes.extentZ[i] };
+			vec3 boundsMin = center - extent, boundsMax = center + extent;
+			if (rebuild) {
+				this->worldMin[i] = boundsMin;
+				this->worldMax[i] = boundsMax;
+			} else if (boundsMin != this->worldMin[i] || boundsMax != this->worldMax[i]) {
+				this->worldMin[i] = boundsMin;
+				this->worldMax[i] = boundsMax;
+				this->bvh.update(uint32_t(i), boundsMin, boundsMax);
+				this->refittedObjects++;
+			}
+		}
+		if (!rebuild) {
+			this->refitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - refitStart).count();
+			return;
+		}
+		auto buildStart = std::chrono::steady_clock::now();
+		this->bvh.build(this->worldMin, this->worldMax);
+		this->bvhBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+		std::cout << "BVH: " << this->bvh.nodes.size() << " nodes over " << count << " objects built in " << this->bvhBuildMs << " ms" << std::endl;
+	}
+
+	// Casts the ray under the cursor against the object boxes
+	void pick(double mouseX, double mouseY) {
+		if (this->bvh.nodes.empty())
+			return;
+		mat4 inverse = glm::inverse(this->projection * this->camera);
+		float x = static_cast<float>(2 * mouseX / this->width - 1);
+		float y = static_cast<float>(1 - 2 * mouseY / this->height);
+		glm::vec4 nearPoint = inverse * glm::vec4(x, y, -1, 1);
+		glm::vec4 farPoint = inverse * glm::vec4(x, y, 1, 1);
+		vec3 origin = vec3(nearPoint) / nearPoint.w;
+		vec3 direction = vec3(farPoint) / farPoint.w - origin;
+		float distance;
+		uint32_t nodesVisited = 0;
+		uint32_t hit = this->bvh.raycast(origin, direction, distance, nodesVisited);
+		if (hit == Bvh::NONE)
+			std::cout << "Picked nothing";
+		else
+			std::cout << "Picked object " << hit << " at " << distance * glm::length(direction) << " units";
+		std::cout << ", " << nodesVisited << " of " << this->bvh.nodes.size() << " BVH nodes visited" << std::endl;
+	}
+
+	void printStats() {
+		if (this->statsFrames == 0)
+			return;
+		std::cout << (this->instancing ? "Instanced" : "Per placement") << ": "
+			<< this->drawCalls / this->statsFrames << " draw calls, "
+			<< this->programSwitches / this->statsFrames << " program, "
+			<< this->textureSwitches / this->statsFrames << " texture and "
+			<< this->vaoSwitches / this->statsFrames << " VAO switches, "
+			<< this->state.issued / this->statsFrames << " state calls issued and "
+			<< this->state.filtered / this->statsFrames << " filtered, "
+			<< this->cullMs / this->statsFrames << " ms culling "
+			<< 100.0 * this->culledObjects / std::max<uint64_t>(this->testedObjects, 1) << "% of objects, "
+			<< this->bvhNodesVisited / this->statsFrames << " BVH nodes visited and "
+			<< this->refittedObjects / this->statsFrames << " objects refitted in "
+			<< this->refitMs / this->statsFrames << " ms, "
+			<< this->cpuMs / this->statsFrames << " ms CPU per frame over " << this->statsFrames << " frames" << std::endl;
+		if (this->gpuCulling) {
+			// Stalls on the GPU, only done when printing
+			GLuint stats[4];
+			this->state.bindBuffer(GL_SHADER_STORAGE_BUFFER, this->cullStatsBuffer);
+			glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(stats), stats);
+			std::cout << "GPU culling: " << stats[0] / this->statsFrames << " draws outside the frustum, "
+				<< stats[1] / this->statsFrames << " occluded and " << stats[2] / this->statsFrames << " recovered by the re-test per frame";
+			if (this->occlusion)
+				std::cout << ", depth pyramid built in " << this->pyramid.buildMs / std::max<uint32_t>(this->pyramid.builds, 1) << " ms GPU";
+			std::cout << std::endl;
+		}
+		this->resetStats();
+	}
+
+	void resetStats() {
+		if (this->gpuCulling) {
+			this->state.bindBuffer(GL_SHADER_STORAGE_BUFFER, this->cullStatsBuffer);
+			glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+			this->pyramid.buildMs = 0;
+			this->pyramid.builds = 0;
+		}
+		this->drawCalls = 0;
+		this->programSwitches = 0;
+		this->textureSwitches = 0;
+		this->vaoSwitches = 0;
+		this->state.resetStats();
+		this->cullMs = 0;
+		this->culledObjects = 0;
+		this->testedObjects = 0;
+		this->bvhNodesVisited = 0;
+		this->refittedObjects = 0;
+		this->refitMs = 0;
+		this->cpuMs = 0;
+		this->statsFrames = 0;
 	}
 
     void deinitialize() {
+		this->printStats();
+		// Before the textures it would upload to are deleted
+		this->textures.destroy();
+		this->textureTable.destroy();
 		for (Obj& object : this->objects)
-			object.destroy();
-
+			object.destroy(this->shaders, this->textureRegistry);
+		for (InstancedObj& object : this->instancedObjects)
+			object.destroy(this->shaders, this->textureRegistry);
+
+		std::cout << "Uniform ring: " << (this->uniformRing.totalBytes / std::max<uint64_t>(this->uniformRing.frames, 1)) << " bytes/frame, "
+			<< this->uniformRing.totalWaitMs << " ms waiting on fences over " << this->uniformRing.frames << " frames, "
+			<< this->uniformRing.overflows << " overflows, grown " << this->uniformRing.grows << " times" << std::endl;
+		if (this->indirect)
+			std::cout << "Draw ring: " << this->drawRing.overflows << " overflows, grown " << this->drawRing.grows << " times" << std::endl;
+		this->uniformRing.destroy();
+		if (this->indirect) {
+			this->drawRing.destroy();
+			this->arena.destroy();
+		}
+		if (this->gpuCulling) {
+			this->cullShader.Destroy();
+			GLuint buffers[] = { this->cullDrawsBuffer, this->culledCommandsBuffer, this->drawCountsBuffer, this->occludedBuffer, this->cullStatsBuffer };
+			glDeleteBuffers(5, buffers);
+		}
+		if (this->occlusion)
+			this->pyramid.destroy();
 		glDeleteBuffers(2, this->pausedBuffers);
 		glDeleteVertexArrays(1, &this->pausedVao);
-		glDeleteTextures(1, &this->pausedTexture);
-        this->basicShader.Destroy();
+		this->textureRegistry.release(this->pausedTexture);
+        this->shaders.release(this->basicShader);
 
 		glfwDestroyCursor(this->handCursor);
     }
 
     inline uint32_t getBasicProgram() {
-        return this->basicShader.GetProgram();
+        return this->basicShader->GetProgram();
     }
 };
 
-void Obj::render() {
-	auto time = static_cast<float>(glfwGetTime());
-
-	uint32_t prog = this->getProgram();
-	glUseProgram(prog);
-
-	const int32_t PROG_TIME = glGetUniformLocation(prog, "time");
-	const int32_t PROG_SAMPLER = glGetUniformLocation(prog, "sampler_");
-	const int32_t PROG_LIGHT_DIRECTION = glGetUniformLocation(prog, "light.direction");
-	const int32_t PROG_LIGHT_AMBIENT_COLOR = glGetUniformLocation(prog, "light.ambientColor");
-	const int32_t PROG_LIGHT_DIFFUSE_COLOR = glGetUniformLocation(prog, "light.diffuseColor");
-	const int32_t PROG_LIGHT_SPECULAR_COLOR = glGetUniformLocation(prog, "light.specularColor");
-	const int32_t PROG_MATERIAL_AMBIENT_COLOR = glGetUniformLocation(prog, "material.ambientColor");
-	const int32_t PROG_MATERIAL_DIFFUSE_COLOR = glGetUniformLocation(prog, "material.diffuseColor");
-	const int32_t PROG_MATERIAL_SPECULAR_COLOR = glGetUniformLocation(prog, "material.specularColor");
-	const int32_t PROG_SHININESS = glGetUniformLocation(prog, "shininess");
-	glUniform1f(PROG_TIME, time);
-	glUniform1i(PROG_SAMPLER, 0);
-	glUniform3f(PROG_LIGHT_DIRECTION, 1, -1, -1);
-	glUniform3f(PROG_LIGHT_AMBIENT_COLOR, 0.1, 0.1, 0.1);
-	glUniform3f(PROG_LIGHT_DIFFUSE_COLOR, 1, 1, 1);
-	glUniform3f(PROG_LIGHT_SPECULAR_COLOR, 0.5, 0.5, 0.5);
-	glUniform3f(PROG_MATERIAL_AMBIENT_COLOR, this->material.ambient[0], this->material.ambient[1], this->material.ambient[2]);
-	glUniform3f(PROG_MATERIAL_DIFFUSE_COLOR, this->material.diffuse[0], this->material.diffuse[1], this->material.diffuse[2]);
-	glUniform3f(PROG_MATERIAL_SPECULAR_COLOR, this->material.specular[0], this->material.specular[1], this->material.specular[2]);
-	glUniform1f(PROG_SHININESS, this->material.shininess);
-
-	mat4 scaleMatrix = {
-			this->scale.x, 0, 0, 0,
-			0, this->scale.y, 0, 0,
-			0, 0, this->scale.z, 0,
-			0, 0, 0, 1,
-	};
-	mat4 rotationMatrix = {
-			cos(this->angle), 0, sin(this->angle), 0,
-			0, 1, 0, 0,
-			-sin(this->angle), 0, cos(this->angle), 0,
-			0, 0, 0, 1,
-	};
-	mat4 translationMatrix = {
-			1, 0, 0, 0,
-			0, 1, 0, 0,
-			0, 0, 1, 0,
-			this->translation.x, this->translation.y, this->translation.z, 1,
-	};
-	const int32_t PROG_VIEW = glGetUniformLocation(prog, "view");
-	glUniform3f(PROG_VIEW, this->app.cameraPosition.x, this->app.cameraPosition.y, this->app.cameraPosition.z);
-	mat4 transform = translationMatrix * rotationMatrix * scaleMatrix;
-	mat4 transformNormal = glm::transpose(glm::inverse(transform));
-	mat4 transformWithProjection = this->app.projection * this->app.camera * transform;
-	//glBindBuffer(GL_UNIFORM_BUFFER, this->buffers[2]);
-	//glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(mat4), glm::value_ptr(transformNormal));
-	//glBufferSubData(GL_UNIFORM_BUFFER, sizeof(mat4), sizeof(mat4), glm::value_ptr(transformWithProjection));
-	//glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-	const int32_t PROG_TRANSFORM_NORMAL = glGetUniformLocation(prog, "transformNormal");
-	glUniformMatrix4fv(PROG_TRANSFORM_NORMAL, 1, GL_FALSE, glm::value_ptr(transformNormal));
-	const int32_t PROG_TRANSFORM_WITH_PROJECTION = glGetUniformLocation(prog, "transformWithProjection");
-	glUniformMatrix4fv(PROG_TRANSFORM_WITH_PROJECTION, 1, GL_FALSE, glm::value_ptr(transformWithProjection));
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, this->texture);
-	glBindVertexArray(this->vao);
-	glDrawElements(GL_TRIANGLES, this->numOfIndices, GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
+void InstancedObj::render() {
+	GLState& state = this->app.state;
+	this->app.programSwitches += state.useProgram(this->getProgram());
+	GLShader& shader = *this->shader;
+	shader.SetInt(U_SAMPLER, 0);
+
+	this->app.vaoSwitches += state.bindVertexArray(this->model.vao);
+	if (this->app.instancing) {
+		this->app.drawCalls += this->model.draw(state, shader, this->instanceCount, 0);
+	} else {
+		// Reference path: one draw per placement, as if every instance was its own Obj
+		for (GLsizei i = 0; i < this->instanceCount; i++)
+			this->app.drawCalls += this->model.draw(state, shader, 1, GLuint(i));
+	}
 }
 
-int main() {
+int main(int argc, char** argv) {
     Application app(1280, 960);
     GLFWwindow* window;
 
+	// --apples [side]: adds the instanced apple grid. --compare-instancing [frames]: draws it both ways and exits
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+		bool hasValue = i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]));
+		if (option == "--apples") {
+			app.appleGridSize = hasValue ? std::atoi(argv[++i]) : DEFAULT_APPLE_GRID_SIZE;
+		} else if (option == "--compare-instancing") {
+			app.compareFrames = hasValue ? uint32_t(std::atoi(argv[++i])) : 300;
+			if (app.appleGridSize == 0)
+				app.appleGridSize = DEFAULT_APPLE_GRID_SIZE;
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--apples [side]] [--compare-instancing [frames]]" << std::endl;
+			return -1;
+		}
+	}
+
     /* Initialize the library */
     if (!glfwInit())
         return -1;
@@ -1,11 +1,26 @@
-
 //#include "stdafx.h"
 #include "../common/GLShader.h"
 //#define GLEW_STATIC
 #include "GL/glew.h"
 
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <algorithm>
 #include <iostream>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// "GLPB" : en-tete des fichiers du cache de programmes
+static const uint32_t BINARY_CACHE_MAGIC = 0x42504C47;
+
+std::string GLShader::s_BinaryCacheDirectory;
 
 bool ValidateShader(GLuint shader)
 {
@@ -37,90 +52,124 @@ bool ValidateShader(GLuint shader)
 	return true;
 }
 
-bool GLShader::LoadVertexShader(const char* filename)
+static bool ReadSource(const char* filename, std::string& source)
 {
-	// 1. Charger le fichier en memoire
+	// Charger le fichier en memoire
 	std::ifstream fin(filename, std::ios::in | std::ios::binary);
+	if (!fin)
+	{
+		std::cout << "Impossible d'ouvrir le shader " << filename << std::endl;
+		return false;
+	}
 	fin.seekg(0, std::ios::end);
-	uint32_t length = (uint32_t)fin.tellg();
+	source.resize((size_t)fin.tellg());
 	fin.seekg(0, std::ios::beg);
-	char* buffer = nullptr;
-	buffer = new char[length + 1];
-	buffer[length] = '\0';
-	fin.read(buffer, length);
-
-	// 2. Creer le shader object
-	m_VertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(m_VertexShader, 1, &buffer, nullptr);
-	// 3. Le compiler
-	glCompileShader(m_VertexShader);
-	// 4. Nettoyer
-	delete[] buffer;
-	fin.close();	// non obligatoire ici
-	
-	// 5. 
-	// verifie le status de la compilation
-	return ValidateShader(m_VertexShader);
+	fin.read(&source[0], source.size());
+	return true;
 }
 
-bool GLShader::LoadGeometryShader(const char* filename)
+// FNV-1a 64 bits, suffisant pour nommer les entrees du cache
+static uint64_t HashBytes(uint64_t hash, const char* data, size_t size)
 {
-	// 1. Charger le fichier en memoire
-	std::ifstream fin(filename, std::ios::in | std::ios::binary);
-	fin.seekg(0, std::ios::end);
-	uint32_t length = (uint32_t)fin.tellg();
-	fin.seekg(0, std::ios::beg);
-	char* buffer = nullptr;
-	buffer = new char[length + 1];
-	buffer[length] = '\0';
-	fin.read(buffer, length);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 0x100000001B3ull;
+	}
+	// separateur, pour que "ab"+"c" et "a"+"bc" different
+	hash ^= 0xFF;
+	hash *= 0x100000001B3ull;
+	return hash;
+}
+
+static uint64_t HashString(uint64_t hash, const char* str)
+{
+	return HashBytes(hash, str ? str : "", str ? strlen(str) : 0);
+}
 
-	// 2. Creer le shader object
-	m_GeometryShader = glCreateShader(GL_GEOMETRY_SHADER);
-	glShaderSource(m_GeometryShader, 1, &buffer, nullptr);
-	// 3. Le compiler
-	glCompileShader(m_GeometryShader);
-	// 4. Nettoyer
-	delete[] buffer;
-	fin.close();	// non obligatoire ici
+void GLShader::SetBinaryCacheDirectory(const char* directory)
+{
+	s_BinaryCacheDirectory = directory ? directory : "";
+	if (s_BinaryCacheDirectory.empty())
+		return;
+#ifdef _WIN32
+	_mkdir(directory);
+#else
+	mkdir(directory, 0755);
+#endif
+}
 
-					// 5. 
-					// verifie le status de la compilation
-	return ValidateShader(m_GeometryShader);
+bool GLShader::LoadVertexShader(const char* filename)
+{
+	// la compilation est differee a Create(), le cache pouvant l'eviter
+	return ReadSource(filename, m_VertexSource);
+}
+
+bool GLShader::LoadGeometryShader(const char* filename)
+{
+	return ReadSource(filename, m_GeometrySource);
 }
 
 bool GLShader::LoadFragmentShader(const char* filename)
 {
-	std::ifstream fin(filename, std::ios::in | std::ios::binary);
-	fin.seekg(0, std::ios::end);
-	uint32_t length = (uint32_t)fin.tellg();
-	fin.seekg(0, std::ios::beg);
-	char* buffer = nullptr;
-	buffer = new char[length + 1];
-	buffer[length] = '\0';
-	fin.read(buffer, length);
-
-	// 2. Creer le shader object
-	m_FragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(m_FragmentShader, 1, &buffer, nullptr);
-	// 3. Le compiler
-	glCompileShader(m_FragmentShader);
-	// 4. Nettoyer
-	delete[] buffer;
-	fin.close();	// non obligatoire ici
-	
-	// 5. 
-	// verifie le status de la compilation
-	return ValidateShader(m_FragmentShader);
+	return ReadSource(filename, m_FragmentSource);
 }
 
-bool GLShader::Create()
+bool GLShader::LoadComputeShader(const char* filename)
+{
+	return ReadSource(filename, m_ComputeSource);
+}
+
+bool GLShader::CompileShader(uint32_t type)
+{
+	uint32_t* shader = &m_VertexShader;
+	const std::string* source = &m_VertexSource;
+	if (type == GL_GEOMETRY_SHADER)
+	{
+		shader = &m_GeometryShader;
+		source = &m_GeometrySource;
+	}
+	else if (type == GL_FRAGMENT_SHADER)
+	{
+		shader = &m_FragmentShader;
+		source = &m_FragmentSource;
+	}
+	else if (type == GL_COMPUTE_SHADER)
+	{
+		shader = &m_ComputeShader;
+		source = &m_ComputeSource;
+	}
+
+	// 1. Creer le shader object
+	*shader = glCreateShader(type);
+	const char* buffer = source->c_str();
+	glShaderSource(*shader, 1, &buffer, nullptr);
+	// 2. Le compiler
+	glCompileShader(*shader);
+
+	// 3. verifie le status de la compilation
+	if (!ValidateShader(*shader))
+	{
+		*shader = 0;
+		return false;
+	}
+	return true;
+}
+
+bool GLShader::Link()
 {
 	m_Program = glCreateProgram();
-	glAttachShader(m_Program, m_VertexShader);
+	if (m_VertexShader)
+		glAttachShader(m_Program, m_VertexShader);
 	if (m_GeometryShader)
 		glAttachShader(m_Program, m_GeometryShader);
-	glAttachShader(m_Program, m_FragmentShader);
+	if (m_FragmentShader)
+		glAttachShader(m_Program, m_FragmentShader);
+	if (m_ComputeShader)
+		glAttachShader(m_Program, m_ComputeShader);
+	// le binaire doit etre recuperable pour etre mis en cache
+	if (!s_BinaryCacheDirectory.empty() && (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+		glProgramParameteri(m_Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(m_Program);
 
 	int32_t linked = 0;
@@ -139,10 +188,11 @@ bool GLShader::Create()
 			glGetProgramInfoLog(m_Program, infoLen, NULL, infoLog);
 			std::cout << "Erreur de lien du programme: " << infoLog << std::endl;
 
-			delete(infoLog);
+			delete[] infoLog;
 		}
 
 		glDeleteProgram(m_Program);
+		m_Program = 0;
 
 		return false;
 	}
@@ -150,14 +200,263 @@ bool GLShader::Create()
 	return true;
 }
 
+std::string GLShader::BinaryCachePath()
+{
+	if (s_BinaryCacheDirectory.empty() || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+		return std::string();
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats == 0)
+		return std::string();
+
+	// un binaire n'est valable que pour le meme pilote et les memes sources
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hash = HashString(hash, (const char*)glGetString(GL_VENDOR));
+	hash = HashString(hash, (const char*)glGetString(GL_RENDERER));
+	hash = HashString(hash, (const char*)glGetString(GL_VERSION));
+	hash = HashBytes(hash, m_VertexSource.data(), m_VertexSource.size());
+	hash = HashBytes(hash, m_GeometrySource.data(), m_GeometrySource.size());
+	hash = HashBytes(hash, m_FragmentSource.data(), m_FragmentSource.size());
+	hash = HashBytes(hash, m_ComputeSource.data(), m_ComputeSource.size());
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.glbin", (unsigned long long)hash);
+	return s_BinaryCacheDirectory + "/" + name;
+}
+
+bool GLShader::LoadBinary(const std::string& path)
+{
+	std::ifstream fin(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!fin)
+		return false;
+	std::streamoff fileSize = fin.tellg();
+	fin.seekg(0);
+	uint32_t header[3];
+	if (fileSize < (std::streamoff)sizeof(header) || !fin.read((char*)header, sizeof(header)) || header[0] != BINARY_CACHE_MAGIC)
+		return false;
+	// la taille annoncee doit tenir dans le reste du fichier, avant toute allocation
+	if (header[2] == 0 || header[2] > (uint64_t)(fileSize - (std::streamoff)sizeof(header)) || header[2] > INT32_MAX)
+		return false;
+	std::vector<char> binary(header[2]);
+	fin.read(binary.data(), binary.size());
+	if ((size_t)fin.gcount() != binary.size())
+		return false;
+
+	m_Program = glCreateProgram();
+	glProgramBinary(m_Program, header[1], binary.data(), (GLsizei)binary.size());
+	int32_t linked = 0;
+	glGetProgramiv(m_Program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		// pilote mis a jour ou binaire corrompu : on recompile
+		glDeleteProgram(m_Program);
+		m_Program = 0;
+		return false;
+	}
+	return true;
+}
+
+void GLShader::SaveBinary(const std::string& path)
+{
+	GLint length = 0;
+	glGetProgramiv(m_Program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(m_Program, length, &length, &format, binary.data());
+
+	// ecriture dans un fichier temporaire puis renommage, pour ne jamais laisser d'entree tronquee
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream fout(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+		uint32_t header[3] = { BINARY_CACHE_MAGIC, format, (uint32_t)length };
+		fout.write((const char*)header, sizeof(header));
+		fout.write(binary.data(), length);
+		if (!fout)
+		{
+			fout.close();
+			remove(temporary.c_str());
+			return;
+		}
+	}
+	remove(path.c_str());
+	rename(temporary.c_str(), path.c_str());
+}
+
+bool GLShader::Create()
+{
+	auto start = std::chrono::steady_clock::now();
+	std::string cachePath = BinaryCachePath();
+
+	if (!cachePath.empty() && LoadBinary(cachePath))
+	{
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "GLShader: programme charge depuis le cache en " << ms << " ms" << std::endl;
+		Reflect();
+		return true;
+	}
+
+	if (!m_ComputeSource.empty())
+	{
+		if (!CompileShader(GL_COMPUTE_SHADER))
+			return false;
+	}
+	else
+	{
+		if (!CompileShader(GL_VERTEX_SHADER))
+			return false;
+		if (!m_GeometrySource.empty() && !CompileShader(GL_GEOMETRY_SHADER))
+			return false;
+		if (!CompileShader(GL_FRAGMENT_SHADER))
+			return false;
+	}
+	if (!Link())
+		return false;
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "GLShader: programme compile en " << ms << " ms" << std::endl;
+	if (!cachePath.empty())
+		SaveBinary(cachePath);
+	Reflect();
+	return true;
+}
+
 void GLShader::Destroy()
 {
-	glDetachShader(m_Program, m_VertexShader);
-	glDetachShader(m_Program, m_FragmentShader);
-	glDetachShader(m_Program, m_GeometryShader);
-	glDeleteShader(m_GeometryShader);
-	glDeleteShader(m_VertexShader);
-	glDeleteShader(m_FragmentShader);
+	// un programme charge depuis le cache n'a pas de shader objects
+	if (m_VertexShader)
+	{
+		glDetachShader(m_Program, m_VertexShader);
+		glDeleteShader(m_VertexShader);
+	}
+	if (m_GeometryShader)
+	{
+		glDetachShader(m_Program, m_GeometryShader);
+		glDeleteShader(m_GeometryShader);
+	}
+	if (m_FragmentShader)
+	{
+		glDetachShader(m_Program, m_FragmentShader);
+		glDeleteShader(m_FragmentShader);
+	}
+	if (m_ComputeShader)
+	{
+		glDetachShader(m_Program, m_ComputeShader);
+		glDeleteShader(m_ComputeShader);
+	}
 	glDeleteProgram(m_Program);
+	m_Program = m_VertexShader = m_GeometryShader = m_FragmentShader = m_ComputeShader = 0;
+	m_Uniforms.clear();
+	m_Attributes.clear();
 }
 
+void GLShader::Reflect()
+{
+	m_Uniforms.clear();
+	m_Attributes.clear();
+
+	char name[256];
+	GLint count = 0;
+	glGetProgramiv(m_Program, GL_ACTIVE_UNIFORMS, &count);
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_Program, i, sizeof(name), &length, &size, &type, name);
+		// "tableau[0]" est accessible sous le nom "tableau"
+		if (length > 3 && strcmp(name + length - 3, "[0]") == 0)
+			name[length - 3] = '\0';
+		// les membres des uniform blocks n'ont pas de location
+		GLint location = glGetUniformLocation(m_Program, name);
+		if (location < 0)
+			continue;
+		Uniform uniform = {};
+		uniform.key = Key(name);
+		uniform.location = location;
+		uniform.type = type;
+		m_Uniforms.push_back(uniform);
+	}
+
+	glGetProgramiv(m_Program, GL_ACTIVE_ATTRIBUTES, &count);
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveAttrib(m_Program, i, sizeof(name), &length, &size, &type, name);
+		GLint location = glGetAttribLocation(m_Program, name);
+		if (location >= 0)
+			m_Attributes.push_back({ Key(name), location });
+	}
+
+	std::sort(m_Uniforms.begin(), m_Uniforms.end(), [](const Uniform& a, const Uniform& b) { return a.key < b.key; });
+	std::sort(m_Attributes.begin(), m_Attributes.end(), [](const Attribute& a, const Attribute& b) { return a.key < b.key; });
+	for (size_t i = 1; i < m_Uniforms.size(); i++)
+		if (m_Uniforms[i - 1].key == m_Uniforms[i].key)
+			std::cout << "GLShader: collision de cles entre deux uniforms" << std::endl;
+}
+
+GLShader::Uniform* GLShader::FindUniform(uint32_t key)
+{
+	auto it = std::lower_bound(m_Uniforms.begin(), m_Uniforms.end(), key, [](const Uniform& uniform, uint32_t key) { return uniform.key < key; });
+	return it != m_Uniforms.end() && it->key == key ? &*it : nullptr;
+}
+
+bool GLShader::Update(Uniform* uniform, const void* value, size_t size)
+{
+	// un uniform absent (optimise par le compilateur GLSL) est ignore, comme une location -1
+	if (!uniform)
+		return false;
+	if (uniform->known && memcmp(uniform->value, value, size) == 0)
+		return false;
+	memcpy(uniform->value, value, size);
+	uniform->known = true;
+	return true;
+}
+
+int32_t GLShader::GetAttribute(uint32_t key)
+{
+	auto it = std::lower_bound(m_Attributes.begin(), m_Attributes.end(), key, [](const Attribute& attribute, uint32_t key) { return attribute.key < key; });
+	return it != m_Attributes.end() && it->key == key ? it->location : -1;
+}
+
+bool GLShader::HasUniform(uint32_t key)
+{
+	return FindUniform(key) != nullptr;
+}
+
+void GLShader::SetInt(uint32_t key, int32_t value)
+{
+	Uniform* uniform = FindUniform(key);
+	if (Update(uniform, &value, sizeof(value)))
+		glUniform1i(uniform->location, value);
+}
+
+void GLShader::SetFloat(uint32_t key, float value)
+{
+	Uniform* uniform = FindUniform(key);
+	if (Update(uniform, &value, sizeof(value)))
+		glUniform1f(uniform->location, value);
+}
+
+void GLShader::SetVec3(uint32_t key, float x, float y, float z)
+{
+	const float value[3] = { x, y, z };
+	SetVec3(key, value);
+}
+
+void GLShader::SetVec3(uint32_t key, const float* value)
+{
+	Uniform* uniform = FindUniform(key);
+	if (Update(uniform, value, 3 * sizeof(float)))
+		glUniform3fv(uniform->location, 1, value);
+}
+
+void GLShader::SetMat4(uint32_t key, const float* value)
+{
+	Uniform* uniform = FindUniform(key);
+	if (Update(uniform, value, 16 * sizeof(float)))
+		glUniformMatrix4fv(uniform->location, 1, GL_FALSE, value);
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
 class GLShader
 {
@@ -14,20 +16,78 @@ private:
 	// Un Fragment Shader est execute pour chaque "pixel"
 	// lors de la rasterization/remplissage de la primitive
 	uint32_t m_FragmentShader;
+	// Un Compute Shader est utilise seul, hors du pipeline de rendu
+	uint32_t m_ComputeShader;
+
+	// sources GLSL, compilees seulement si le cache ne contient pas le programme
+	std::string m_VertexSource;
+	std::string m_GeometrySource;
+	std::string m_FragmentSource;
+	std::string m_ComputeSource;
+
+	// uniform actif, avec la derniere valeur envoyee pour eviter les envois redondants
+	struct Uniform
+	{
+		uint32_t key;
+		int32_t location;
+		uint32_t type;
+		bool known;
+		float value[16];
+	};
+	struct Attribute
+	{
+		uint32_t key;
+		int32_t location;
+	};
+	// tries par cle, remplis une seule fois apres Create()
+	std::vector<Uniform> m_Uniforms;
+	std::vector<Attribute> m_Attributes;
+
+	// repertoire du cache des binaires de programmes (vide = desactive)
+	static std::string s_BinaryCacheDirectory;
 
 	bool CompileShader(uint32_t type);
+	bool Link();
+	std::string BinaryCachePath();
+	bool LoadBinary(const std::string& path);
+	void SaveBinary(const std::string& path);
+	void Reflect();
+	Uniform* FindUniform(uint32_t key);
+	bool Update(Uniform* uniform, const void* value, size_t size);
 public:
 	GLShader() : m_Program(0), m_VertexShader(0),
-		m_GeometryShader(0), m_FragmentShader(0) {
+		m_GeometryShader(0), m_FragmentShader(0), m_ComputeShader(0) {
 
 	}
 	~GLShader() {}
 
 	inline uint32_t GetProgram() { return m_Program; }
 
+	static void SetBinaryCacheDirectory(const char* directory);
+
+	// cle d'un uniform ou d'un attribut (FNV-1a), calculable a la compilation
+	static constexpr uint32_t Key(const char* name)
+	{
+		uint32_t hash = 0x811C9DC5;
+		while (*name)
+			hash = (hash ^ (unsigned char)*name++) * 0x01000193;
+		return hash;
+	}
+
 	bool LoadVertexShader(const char* filename);
 	bool LoadGeometryShader(const char* filename);
 	bool LoadFragmentShader(const char* filename);
+	// exclusif avec les autres etapes
+	bool LoadComputeShader(const char* filename);
 	bool Create();
 	void Destroy();
-};
\ No newline at end of file
+
+	int32_t GetAttribute(uint32_t key);
+	bool HasUniform(uint32_t key);
+	// le programme doit etre actif (glUseProgram), sauf si la valeur n'a pas change
+	void SetInt(uint32_t key, int32_t value);
+	void SetFloat(uint32_t key, float value);
+	void SetVec3(uint32_t key, float x, float y, float z);
+	void SetVec3(uint32_t key, const float* value);
+	void SetMat4(uint32_t key, const float* value);
+};
@@ -629,6 +629,43 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              MaterialReader *readMatFn = NULL, bool triangulate = true,
              bool default_vcols_fallback = true);
 
+/// Loads object from a memory buffer (e.g. a memory mapped file).
+/// `v`, `vn`, `vt` and `f` lines are tokenized on `num_threads` threads
+/// (0 = hardware concurrency), then merged in file order: the result is
+/// identical to LoadObj.
+bool LoadObjParallel(attrib_t *attrib, std::vector<shape_t> *shapes,
+                     std::vector<material_t> *materials, std::string *warn,
+                     std::string *err, const char *buf, size_t len,
+                     MaterialReader *readMatFn = NULL, bool triangulate = true,
+                     bool default_vcols_fallback = true,
+                     unsigned int num_threads = 0);
+
+/// Receives the faces of LoadObjStreamed as they are parsed.
+struct stream_callback_t {
+  // Faces of a shape, moved out once the call returns. A shape whose faces
+  // span several windows arrives in several parts with the same name.
+  // `attrib` holds the `v`, `vn` and `vt` read so far, which are all the
+  // faces can use: forward references are out of bounds
+  void (*shape_cb)(void *user_data, const attrib_t &attrib, shape_t *shape);
+  // The first `consumed` bytes of the buffer will not be read again
+  void (*consumed_cb)(void *user_data, size_t consumed);
+
+  stream_callback_t() : shape_cb(NULL), consumed_cb(NULL) {}
+};
+
+/// Same parse as LoadObjParallel, one `window_size` window of the buffer at a
+/// time: faces are handed to `callback` after each window instead of being
+/// kept for the whole file, so that only the attributes grow with the file.
+/// `attrib` ends up like with LoadObjParallel.
+bool LoadObjStreamed(attrib_t *attrib, std::vector<material_t> *materials,
+                     const stream_callback_t &callback, void *user_data,
+                     std::string *warn, std::string *err, const char *buf,
+                     size_t len, MaterialReader *readMatFn = NULL,
+                     bool triangulate = true,
+                     bool default_vcols_fallback = true,
+                     unsigned int num_threads = 0,
+                     size_t window_size = 8 * 1024 * 1024);
+
 /// Loads materials into std::map
 void LoadMtl(std::map<std::string, int> *material_map,
              std::vector<material_t> *materials, std::istream *inStream,
@@ -662,6 +699,7 @@ bool ParseTextureNameAndOption(std::string *texname, texture_option_t *texopt,
 #include <limits>
 #include <set>
 #include <sstream>
+#include <thread>
 #include <utility>
 
 #ifdef TINYOBJLOADER_USE_MAPBOX_EARCUT
@@ -861,6 +899,119 @@ static inline int parseInt(const char **token) {
   return i;
 }
 
+// Parses the next 8 bytes as decimal digits, SWAR style (eight digits per
+// 64-bit multiply chain instead of one per loop iteration).
+// Returns false when they are not all digits.
+static inline bool parseEightDigits(const char *s, unsigned int *value) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  (void)s;
+  (void)value;
+  return false;
+#else
+  unsigned long long chunk;
+  memcpy(&chunk, s, sizeof(chunk));
+  if ((((chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+        (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) !=
+       0x3333333333333333ULL)) {
+    return false;
+  }
+  chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+  chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+  *value = static_cast<unsigned int>(
+      ((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+  return true;
+#endif
+}
+
+// Same as parseEightDigits, for the next 4 bytes.
+static inline bool parseFourDigits(const char *s, unsigned int *value) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  (void)s;
+  (void)value;
+  return false;
+#else
+  unsigned int chunk;
+  memcpy(&chunk, s, sizeof(chunk));
+  if ((((chunk & 0xF0F0F0F0U) |
+        (((chunk + 0x06060606U) & 0xF0F0F0F0U) >> 4)) != 0x33333333U)) {
+    return false;
+  }
+  chunk = ((chunk & 0x0F0F0F0FU) * 2561) >> 8;
+  *value = ((chunk & 0x00FF00FFU) * 6553601) >> 16;
+  return true;
+#endif
+}
+
+// Accumulates decimal digits into `mantissa`, failing past 19 digits.
+static inline const char *readDecimalDigits(const char *curr,
+                                            const char *s_end,
+                                            unsigned long long *mantissa,
+                                            int *digits, bool *overflow) {
+  unsigned int eight;
+  while (s_end - curr >= 8 && (*digits) <= 11 &&
+         parseEightDigits(curr, &eight)) {
+    (*mantissa) = (*mantissa) * 100000000ULL + eight;
+    (*digits) += 8;
+    curr += 8;
+  }
+  if (s_end - curr >= 4 && (*digits) <= 15 && parseFourDigits(curr, &eight)) {
+    (*mantissa) = (*mantissa) * 10000ULL + eight;
+    (*digits) += 4;
+    curr += 4;
+  }
+  while (curr != s_end && IS_DIGIT(*curr)) {
+    if ((*digits) >= 19) {
+      (*overflow) = true;
+      return curr;
+    }
+    (*mantissa) = (*mantissa) * 10 + static_cast<unsigned int>(*curr - '0');
+    (*digits)++;
+    curr++;
+  }
+  return curr;
+}
+
+// Fast path for plain decimals such as `-12.345678`, which is what `v`, `vn`
+// and `vt` lines are made of. The digits are gathered into an integer and
+// divided by an exact power of ten: when both fit in a double mantissa the
+// result is correctly rounded, like strtod. Anything else (exponent, too many
+// digits) is left to the general path in tryParseDouble.
+static inline bool tryParseDecimalFast(const char *s, const char *s_end,
+                                       double *result) {
+  static const double exact_pow10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+
+  const char *curr = s;
+  bool negative = false;
+  if (*curr == '+' || *curr == '-') {
+    negative = (*curr == '-');
+    curr++;
+  }
+
+  unsigned long long mantissa = 0;
+  int digits = 0;
+  bool overflow = false;
+  curr = readDecimalDigits(curr, s_end, &mantissa, &digits, &overflow);
+  int integer_digits = digits;
+
+  if (!overflow && curr != s_end && *curr == '.') {
+    curr++;
+    curr = readDecimalDigits(curr, s_end, &mantissa, &digits, &overflow);
+  }
+  int fraction_digits = digits - integer_digits;
+
+  if (overflow || digits == 0 || curr != s_end ||
+      mantissa > (1ULL << 53)) {
+    return false;
+  }
+
+  double value = static_cast<double>(mantissa) / exact_pow10[fraction_digits];
+  *result = negative ? -value : value;
+  return true;
+}
+
 // Tries to parse a floating point number located at s.
 //
 // s_end should be a location in the string where reading should absolutely
@@ -893,6 +1044,10 @@ static bool tryParseDouble(const char *s, const char *s_end, double *result) {
     return false;
   }
 
+  if (tryParseDecimalFast(s, s_end, result)) {
+    return true;
+  }
+
   double mantissa = 0.0;
   // This exponent is base 2 rather than 10.
   // However the exponent we parse is supposed to be one of ten,
@@ -1020,9 +1175,16 @@ fail:
   return false;
 }
 
+// Equivalent to `s + strcspn(s, " \t\r")`, inlined for the short tokens of
+// numeric lines.
+static inline const char *findTokenEnd(const char *s) {
+  while (*s && !IS_SPACE(*s) && *s != '\r') s++;
+  return s;
+}
+
 static inline real_t parseReal(const char **token, double default_value = 0.0) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
+  while (IS_SPACE(**token)) (*token)++;
+  const char *end = findTokenEnd(*token);
   double val = default_value;
   tryParseDouble((*token), end, &val);
   real_t f = static_cast<real_t>(val);
@@ -1031,8 +1193,8 @@ static inline real_t parseReal(const char **token, double default_value = 0.0) {
 }
 
 static inline bool parseReal(const char **token, real_t *out) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
+  while (IS_SPACE(**token)) (*token)++;
+  const char *end = findTokenEnd(*token);
   double val;
   bool ret = tryParseDouble((*token), end, &val);
   if (ret) {
@@ -2555,13 +2717,8 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
                  triangulate, default_vcols_fallback);
 }
 
-bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
-             std::vector<material_t> *materials, std::string *warn,
-             std::string *err, std::istream *inStream,
-             MaterialReader *readMatFn /*= NULL*/, bool triangulate,
-             bool default_vcols_fallback) {
-  std::stringstream errss;
-
+// Parser state shared by every line of an .obj file
+struct ObjParseState {
   std::vector<real_t> v;
   std::vector<real_t> vn;
   std::vector<real_t> vt;
@@ -2574,492 +2731,523 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
   // material
   std::set<std::string> material_filenames;
   std::map<std::string, int> material_map;
-  int material = -1;
+  int material;
 
   // smoothing group id
-  unsigned int current_smoothing_id =
-      0;  // Initial value. 0 means no smoothing.
+  unsigned int current_smoothing_id;
 
-  int greatest_v_idx = -1;
-  int greatest_vn_idx = -1;
-  int greatest_vt_idx = -1;
+  int greatest_v_idx;
+  int greatest_vn_idx;
+  int greatest_vt_idx;
 
   shape_t shape;
 
-  bool found_all_colors = true;
-
-  size_t line_num = 0;
-  std::string linebuf;
-  while (inStream->peek() != -1) {
-    safeGetline(*inStream, linebuf);
+  bool found_all_colors;
 
-    line_num++;
+  size_t line_num;
 
-    // Trim newline '\r\n' or '\n'
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size() - 1] == '\n')
-        linebuf.erase(linebuf.size() - 1);
-    }
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size() - 1] == '\r')
-        linebuf.erase(linebuf.size() - 1);
-    }
+  ObjParseState()
+      : material(-1),
+        current_smoothing_id(0),  // Initial value. 0 means no smoothing.
+        greatest_v_idx(-1),
+        greatest_vn_idx(-1),
+        greatest_vt_idx(-1),
+        found_all_colors(true),
+        line_num(0) {}
+};
 
-    // Skip if empty line.
-    if (linebuf.empty()) {
-      continue;
+// Parses one trimmed, non-empty and non-comment .obj line.
+// Returns false on a parse error.
+static bool ParseObjLine(ObjParseState &state, const char *token,
+                         std::vector<shape_t> *shapes,
+                         std::vector<material_t> *materials, std::string *warn,
+                         std::string *err, MaterialReader *readMatFn,
+                         bool triangulate, bool default_vcols_fallback) {
+  std::vector<real_t> &v = state.v;
+  std::vector<real_t> &vn = state.vn;
+  std::vector<real_t> &vt = state.vt;
+  std::vector<real_t> &vc = state.vc;
+  std::vector<skin_weight_t> &vw = state.vw;
+  std::vector<tag_t> &tags = state.tags;
+  PrimGroup &prim_group = state.prim_group;
+  std::string &name = state.name;
+  std::set<std::string> &material_filenames = state.material_filenames;
+  std::map<std::string, int> &material_map = state.material_map;
+  int &material = state.material;
+  unsigned int &current_smoothing_id = state.current_smoothing_id;
+  int &greatest_v_idx = state.greatest_v_idx;
+  int &greatest_vn_idx = state.greatest_vn_idx;
+  int &greatest_vt_idx = state.greatest_vt_idx;
+  shape_t &shape = state.shape;
+  bool &found_all_colors = state.found_all_colors;
+  const size_t line_num = state.line_num;
+
+  // vertex
+  if (token[0] == 'v' && IS_SPACE((token[1]))) {
+    token += 2;
+    real_t x, y, z;
+    real_t r, g, b;
+
+    found_all_colors &= parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+
+    v.push_back(x);
+    v.push_back(y);
+    v.push_back(z);
+
+    if (found_all_colors || default_vcols_fallback) {
+      vc.push_back(r);
+      vc.push_back(g);
+      vc.push_back(b);
     }
 
-    // Skip leading space.
-    const char *token = linebuf.c_str();
-    token += strspn(token, " \t");
-
-    assert(token);
-    if (token[0] == '\0') continue;  // empty line
-
-    if (token[0] == '#') continue;  // comment line
-
-    // vertex
-    if (token[0] == 'v' && IS_SPACE((token[1]))) {
-      token += 2;
-      real_t x, y, z;
-      real_t r, g, b;
-
-      found_all_colors &= parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
-
-      v.push_back(x);
-      v.push_back(y);
-      v.push_back(z);
-
-      if (found_all_colors || default_vcols_fallback) {
-        vc.push_back(r);
-        vc.push_back(g);
-        vc.push_back(b);
-      }
+    return true;
+  }
 
-      continue;
-    }
+  // normal
+  if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
+    token += 3;
+    real_t x, y, z;
+    parseReal3(&x, &y, &z, &token);
+    vn.push_back(x);
+    vn.push_back(y);
+    vn.push_back(z);
+    return true;
+  }
 
-    // normal
-    if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
-      token += 3;
-      real_t x, y, z;
-      parseReal3(&x, &y, &z, &token);
-      vn.push_back(x);
-      vn.push_back(y);
-      vn.push_back(z);
-      continue;
-    }
+  // texcoord
+  if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
+    token += 3;
+    real_t x, y;
+    parseReal2(&x, &y, &token);
+    vt.push_back(x);
+    vt.push_back(y);
+    return true;
+  }
 
-    // texcoord
-    if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
-      token += 3;
-      real_t x, y;
-      parseReal2(&x, &y, &token);
-      vt.push_back(x);
-      vt.push_back(y);
-      continue;
-    }
+  // skin weight. tinyobj extension
+  if (token[0] == 'v' && token[1] == 'w' && IS_SPACE((token[2]))) {
+    token += 3;
 
-    // skin weight. tinyobj extension
-    if (token[0] == 'v' && token[1] == 'w' && IS_SPACE((token[2]))) {
-      token += 3;
+    // vw <vid> <joint_0> <weight_0> <joint_1> <weight_1> ...
+    // example:
+    // vw 0 0 0.25 1 0.25 2 0.5
 
-      // vw <vid> <joint_0> <weight_0> <joint_1> <weight_1> ...
-      // example:
-      // vw 0 0 0.25 1 0.25 2 0.5
+    // TODO(syoyo): Add syntax check
+    int vid = 0;
+    vid = parseInt(&token);
 
-      // TODO(syoyo): Add syntax check
-      int vid = 0;
-      vid = parseInt(&token);
+    skin_weight_t sw;
 
-      skin_weight_t sw;
+    sw.vertex_id = vid;
 
-      sw.vertex_id = vid;
+    while (!IS_NEW_LINE(token[0])) {
+      real_t j, w;
+      // joint_id should not be negative, weight may be negative
+      // TODO(syoyo): # of elements check
+      parseReal2(&j, &w, &token, -1.0);
 
-      while (!IS_NEW_LINE(token[0])) {
-        real_t j, w;
-        // joint_id should not be negative, weight may be negative
-        // TODO(syoyo): # of elements check
-        parseReal2(&j, &w, &token, -1.0);
-
-        if (j < static_cast<real_t>(0)) {
-          if (err) {
-            std::stringstream ss;
-            ss << "Failed parse `vw' line. joint_id is negative. "
-                  "line "
-               << line_num << ".)\n";
-            (*err) += ss.str();
-          }
-          return false;
+      if (j < static_cast<real_t>(0)) {
+        if (err) {
+          std::stringstream ss;
+          ss << "Failed parse `vw' line. joint_id is negative. "
+                "line "
+             << line_num << ".)\n";
+          (*err) += ss.str();
         }
+        return false;
+      }
 
-        joint_and_weight_t jw;
-
-        jw.joint_id = int(j);
-        jw.weight = w;
+      joint_and_weight_t jw;
 
-        sw.weightValues.push_back(jw);
+      jw.joint_id = int(j);
+      jw.weight = w;
 
-        size_t n = strspn(token, " \t\r");
-        token += n;
-      }
+      sw.weightValues.push_back(jw);
 
-      vw.push_back(sw);
+      size_t n = strspn(token, " \t\r");
+      token += n;
     }
 
-    warning_context context;
-    context.warn = warn;
-    context.line_number = line_num;
-
-    // line
-    if (token[0] == 'l' && IS_SPACE((token[1]))) {
-      token += 2;
+    vw.push_back(sw);
+  }
 
-      __line_t line;
+  warning_context context;
+  context.warn = warn;
+  context.line_number = line_num;
 
-      while (!IS_NEW_LINE(token[0])) {
-        vertex_index_t vi;
-        if (!parseTriple(&token, static_cast<int>(v.size() / 3),
-                         static_cast<int>(vn.size() / 3),
-                         static_cast<int>(vt.size() / 2), &vi, context)) {
-          if (err) {
-            (*err) += "Failed to parse `l' line (e.g. a zero value for vertex index. Line " +
-                toString(line_num) + ").\n";
-          }
-          return false;
+  // line
+  if (token[0] == 'l' && IS_SPACE((token[1]))) {
+    token += 2;
+
+    __line_t line;
+
+    while (!IS_NEW_LINE(token[0])) {
+      vertex_index_t vi;
+      if (!parseTriple(&token, static_cast<int>(v.size() / 3),
+                       static_cast<int>(vn.size() / 3),
+                       static_cast<int>(vt.size() / 2), &vi, context)) {
+        if (err) {
+          (*err) += "Failed to parse `l' line (e.g. a zero value for vertex index. Line " +
+              toString(line_num) + ").\n";
         }
-
-        line.vertex_indices.push_back(vi);
-
-        size_t n = strspn(token, " \t\r");
-        token += n;
+        return false;
       }
 
-      prim_group.lineGroup.push_back(line);
+      line.vertex_indices.push_back(vi);
 
-      continue;
+      size_t n = strspn(token, " \t\r");
+      token += n;
     }
 
-    // points
-    if (token[0] == 'p' && IS_SPACE((token[1]))) {
-      token += 2;
+    prim_group.lineGroup.push_back(line);
 
-      __points_t pts;
+    return true;
+  }
 
-      while (!IS_NEW_LINE(token[0])) {
-        vertex_index_t vi;
-        if (!parseTriple(&token, static_cast<int>(v.size() / 3),
-                         static_cast<int>(vn.size() / 3),
-                         static_cast<int>(vt.size() / 2), &vi, context)) {
-          if (err) {
-            (*err) += "Failed to parse `p' line (e.g. a zero value for vertex index. Line " +
-                toString(line_num) + ").\n";
-          }
-          return false;
+  // points
+  if (token[0] == 'p' && IS_SPACE((token[1]))) {
+    token += 2;
+
+    __points_t pts;
+
+    while (!IS_NEW_LINE(token[0])) {
+      vertex_index_t vi;
+      if (!parseTriple(&token, static_cast<int>(v.size() / 3),
+                       static_cast<int>(vn.size() / 3),
+                       static_cast<int>(vt.size() / 2), &vi, context)) {
+        if (err) {
+          (*err) += "Failed to parse `p' line (e.g. a zero value for vertex index. Line " +
+              toString(line_num) + ").\n";
         }
-
-        pts.vertex_indices.push_back(vi);
-
-        size_t n = strspn(token, " \t\r");
-        token += n;
+        return false;
       }
 
-      prim_group.pointsGroup.push_back(pts);
+      pts.vertex_indices.push_back(vi);
 
-      continue;
+      size_t n = strspn(token, " \t\r");
+      token += n;
     }
 
-    // face
-    if (token[0] == 'f' && IS_SPACE((token[1]))) {
-      token += 2;
-      token += strspn(token, " \t");
+    prim_group.pointsGroup.push_back(pts);
 
-      face_t face;
+    return true;
+  }
 
-      face.smoothing_group_id = current_smoothing_id;
-      face.vertex_indices.reserve(3);
+  // face
+  if (token[0] == 'f' && IS_SPACE((token[1]))) {
+    token += 2;
+    token += strspn(token, " \t");
 
-      while (!IS_NEW_LINE(token[0])) {
-        vertex_index_t vi;
-        if (!parseTriple(&token, static_cast<int>(v.size() / 3),
-                         static_cast<int>(vn.size() / 3),
-                         static_cast<int>(vt.size() / 2), &vi, context)) {
-          if (err) {
-            (*err) += "Failed to parse `f' line (e.g. a zero value for vertex index or invalid relative vertex index). Line " +
-                toString(line_num) + ").\n";
-          }
-          return false;
-        }
+    face_t face;
 
-        greatest_v_idx = greatest_v_idx > vi.v_idx ? greatest_v_idx : vi.v_idx;
-        greatest_vn_idx =
-            greatest_vn_idx > vi.vn_idx ? greatest_vn_idx : vi.vn_idx;
-        greatest_vt_idx =
-            greatest_vt_idx > vi.vt_idx ? greatest_vt_idx : vi.vt_idx;
+    face.smoothing_group_id = current_smoothing_id;
+    face.vertex_indices.reserve(3);
 
-        face.vertex_indices.push_back(vi);
-        size_t n = strspn(token, " \t\r");
-        token += n;
+    while (!IS_NEW_LINE(token[0])) {
+      vertex_index_t vi;
+      if (!parseTriple(&token, static_cast<int>(v.size() / 3),
+                       static_cast<int>(vn.size() / 3),
+                       static_cast<int>(vt.size() / 2), &vi, context)) {
+        if (err) {
+          (*err) += "Failed to parse `f' line (e.g. a zero value for vertex index or invalid relative vertex index). Line " +
+              toString(line_num) + ").\n";
+        }
+        return false;
       }
 
-      // replace with emplace_back + std::move on C++11
-      prim_group.faceGroup.push_back(face);
+      greatest_v_idx = greatest_v_idx > vi.v_idx ? greatest_v_idx : vi.v_idx;
+      greatest_vn_idx =
+          greatest_vn_idx > vi.vn_idx ? greatest_vn_idx : vi.vn_idx;
+      greatest_vt_idx =
+          greatest_vt_idx > vi.vt_idx ? greatest_vt_idx : vi.vt_idx;
 
-      continue;
+      face.vertex_indices.push_back(vi);
+      size_t n = strspn(token, " \t\r");
+      token += n;
     }
 
-    // use mtl
-    if ((0 == strncmp(token, "usemtl", 6))) {
-      token += 6;
-      std::string namebuf = parseString(&token);
+    // replace with emplace_back + std::move on C++11
+    prim_group.faceGroup.push_back(face);
 
-      int newMaterialId = -1;
-      std::map<std::string, int>::const_iterator it =
-          material_map.find(namebuf);
-      if (it != material_map.end()) {
-        newMaterialId = it->second;
-      } else {
-        // { error!! material not found }
-        if (warn) {
-          (*warn) += "material [ '" + namebuf + "' ] not found in .mtl\n";
-        }
-      }
+    return true;
+  }
 
-      if (newMaterialId != material) {
-        // Create per-face material. Thus we don't add `shape` to `shapes` at
-        // this time.
-        // just clear `faceGroup` after `exportGroupsToShape()` call.
-        exportGroupsToShape(&shape, prim_group, tags, material, name,
-                            triangulate, v, warn);
-        prim_group.faceGroup.clear();
-        material = newMaterialId;
+  // use mtl
+  if ((0 == strncmp(token, "usemtl", 6))) {
+    token += 6;
+    std::string namebuf = parseString(&token);
+
+    int newMaterialId = -1;
+    std::map<std::string, int>::const_iterator it =
+        material_map.find(namebuf);
+    if (it != material_map.end()) {
+      newMaterialId = it->second;
+    } else {
+      // { error!! material not found }
+      if (warn) {
+        (*warn) += "material [ '" + namebuf + "' ] not found in .mtl\n";
       }
+    }
 
-      continue;
+    if (newMaterialId != material) {
+      // Create per-face material. Thus we don't add `shape` to `shapes` at
+      // this time.
+      // just clear `faceGroup` after `exportGroupsToShape()` call.
+      exportGroupsToShape(&shape, prim_group, tags, material, name,
+                          triangulate, v, warn);
+      prim_group.faceGroup.clear();
+      material = newMaterialId;
     }
 
-    // load mtl
-    if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
-      if (readMatFn) {
-        token += 7;
+    return true;
+  }
 
-        std::vector<std::string> filenames;
-        SplitString(std::string(token), ' ', '\\', filenames);
+  // load mtl
+  if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
+    if (readMatFn) {
+      token += 7;
 
-        if (filenames.empty()) {
-          if (warn) {
-            std::stringstream ss;
-            ss << "Looks like empty filename for mtllib. Use default "
-                  "material (line "
-               << line_num << ".)\n";
+      std::vector<std::string> filenames;
+      SplitString(std::string(token), ' ', '\\', filenames);
+
+      if (filenames.empty()) {
+        if (warn) {
+          std::stringstream ss;
+          ss << "Looks like empty filename for mtllib. Use default "
+                "material (line "
+             << line_num << ".)\n";
 
-            (*warn) += ss.str();
+          (*warn) += ss.str();
+        }
+      } else {
+        bool found = false;
+        for (size_t s = 0; s < filenames.size(); s++) {
+          if (material_filenames.count(filenames[s]) > 0) {
+            found = true;
+            continue;
           }
-        } else {
-          bool found = false;
-          for (size_t s = 0; s < filenames.size(); s++) {
-            if (material_filenames.count(filenames[s]) > 0) {
-              found = true;
-              continue;
-            }
 
-            std::string warn_mtl;
-            std::string err_mtl;
-            bool ok = (*readMatFn)(filenames[s].c_str(), materials,
-                                   &material_map, &warn_mtl, &err_mtl);
-            if (warn && (!warn_mtl.empty())) {
-              (*warn) += warn_mtl;
-            }
+          std::string warn_mtl;
+          std::string err_mtl;
+          bool ok = (*readMatFn)(filenames[s].c_str(), materials,
+                                 &material_map, &warn_mtl, &err_mtl);
+          if (warn && (!warn_mtl.empty())) {
+            (*warn) += warn_mtl;
+          }
 
-            if (err && (!err_mtl.empty())) {
-              (*err) += err_mtl;
-            }
+          if (err && (!err_mtl.empty())) {
+            (*err) += err_mtl;
+          }
 
-            if (ok) {
-              found = true;
-              material_filenames.insert(filenames[s]);
-              break;
-            }
+          if (ok) {
+            found = true;
+            material_filenames.insert(filenames[s]);
+            break;
           }
+        }
 
-          if (!found) {
-            if (warn) {
-              (*warn) +=
-                  "Failed to load material file(s). Use default "
-                  "material.\n";
-            }
+        if (!found) {
+          if (warn) {
+            (*warn) +=
+                "Failed to load material file(s). Use default "
+                "material.\n";
           }
         }
       }
-
-      continue;
     }
 
-    // group name
-    if (token[0] == 'g' && IS_SPACE((token[1]))) {
-      // flush previous face group.
-      bool ret = exportGroupsToShape(&shape, prim_group, tags, material, name,
-                                     triangulate, v, warn);
-      (void)ret;  // return value not used.
+    return true;
+  }
 
-      if (shape.mesh.indices.size() > 0) {
-        shapes->push_back(shape);
-      }
+  // group name
+  if (token[0] == 'g' && IS_SPACE((token[1]))) {
+    // flush previous face group.
+    bool ret = exportGroupsToShape(&shape, prim_group, tags, material, name,
+                                   triangulate, v, warn);
+    (void)ret;  // return value not used.
 
-      shape = shape_t();
+    if (shape.mesh.indices.size() > 0) {
+      shapes->push_back(shape);
+    }
 
-      // material = -1;
-      prim_group.clear();
+    shape = shape_t();
 
-      std::vector<std::string> names;
+    // material = -1;
+    prim_group.clear();
 
-      while (!IS_NEW_LINE(token[0])) {
-        std::string str = parseString(&token);
-        names.push_back(str);
-        token += strspn(token, " \t\r");  // skip tag
-      }
+    std::vector<std::string> names;
 
-      // names[0] must be 'g'
+    while (!IS_NEW_LINE(token[0])) {
+      std::string str = parseString(&token);
+      names.push_back(str);
+      token += strspn(token, " \t\r");  // skip tag
+    }
 
-      if (names.size() < 2) {
-        // 'g' with empty names
-        if (warn) {
-          std::stringstream ss;
-          ss << "Empty group name. line: " << line_num << "\n";
-          (*warn) += ss.str();
-          name = "";
-        }
-      } else {
-        std::stringstream ss;
-        ss << names[1];
+    // names[0] must be 'g'
 
-        // tinyobjloader does not support multiple groups for a primitive.
-        // Currently we concatinate multiple group names with a space to get
-        // single group name.
+    if (names.size() < 2) {
+      // 'g' with empty names
+      if (warn) {
+        std::stringstream ss;
+        ss << "Empty group name. line: " << line_num << "\n";
+        (*warn) += ss.str();
+        name = "";
+      }
+    } else {
+      std::stringstream ss;
+      ss << names[1];
 
-        for (size_t i = 2; i < names.size(); i++) {
-          ss << " " << names[i];
-        }
+      // tinyobjloader does not support multiple groups for a primitive.
+      // Currently we concatinate multiple group names with a space to get
+      // single group name.
 
-        name = ss.str();
+      for (size_t i = 2; i < names.size(); i++) {
+        ss << " " << names[i];
       }
 
-      continue;
+      name = ss.str();
     }
 
-    // object name
-    if (token[0] == 'o' && IS_SPACE((token[1]))) {
-      // flush previous face group.
-      bool ret = exportGroupsToShape(&shape, prim_group, tags, material, name,
-                                     triangulate, v, warn);
-      (void)ret;  // return value not used.
-
-      if (shape.mesh.indices.size() > 0 || shape.lines.indices.size() > 0 ||
-          shape.points.indices.size() > 0) {
-        shapes->push_back(shape);
-      }
+    return true;
+  }
 
-      // material = -1;
-      prim_group.clear();
-      shape = shape_t();
+  // object name
+  if (token[0] == 'o' && IS_SPACE((token[1]))) {
+    // flush previous face group.
+    bool ret = exportGroupsToShape(&shape, prim_group, tags, material, name,
+                                   triangulate, v, warn);
+    (void)ret;  // return value not used.
 
-      // @todo { multiple object name? }
-      token += 2;
-      std::stringstream ss;
-      ss << token;
-      name = ss.str();
-
-      continue;
+    if (shape.mesh.indices.size() > 0 || shape.lines.indices.size() > 0 ||
+        shape.points.indices.size() > 0) {
+      shapes->push_back(shape);
     }
 
-    if (token[0] == 't' && IS_SPACE(token[1])) {
-      const int max_tag_nums = 8192;  // FIXME(syoyo): Parameterize.
-      tag_t tag;
+    // material = -1;
+    prim_group.clear();
+    shape = shape_t();
 
-      token += 2;
+    // @todo { multiple object name? }
+    token += 2;
+    std::stringstream ss;
+    ss << token;
+    name = ss.str();
 
-      tag.name = parseString(&token);
+    return true;
+  }
 
-      tag_sizes ts = parseTagTriple(&token);
+  if (token[0] == 't' && IS_SPACE(token[1])) {
+    const int max_tag_nums = 8192;  // FIXME(syoyo): Parameterize.
+    tag_t tag;
 
-      if (ts.num_ints < 0) {
-        ts.num_ints = 0;
-      }
-      if (ts.num_ints > max_tag_nums) {
-        ts.num_ints = max_tag_nums;
-      }
+    token += 2;
 
-      if (ts.num_reals < 0) {
-        ts.num_reals = 0;
-      }
-      if (ts.num_reals > max_tag_nums) {
-        ts.num_reals = max_tag_nums;
-      }
+    tag.name = parseString(&token);
 
-      if (ts.num_strings < 0) {
-        ts.num_strings = 0;
-      }
-      if (ts.num_strings > max_tag_nums) {
-        ts.num_strings = max_tag_nums;
-      }
+    tag_sizes ts = parseTagTriple(&token);
 
-      tag.intValues.resize(static_cast<size_t>(ts.num_ints));
+    if (ts.num_ints < 0) {
+      ts.num_ints = 0;
+    }
+    if (ts.num_ints > max_tag_nums) {
+      ts.num_ints = max_tag_nums;
+    }
 
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_ints); ++i) {
-        tag.intValues[i] = parseInt(&token);
-      }
+    if (ts.num_reals < 0) {
+      ts.num_reals = 0;
+    }
+    if (ts.num_reals > max_tag_nums) {
+      ts.num_reals = max_tag_nums;
+    }
 
-      tag.floatValues.resize(static_cast<size_t>(ts.num_reals));
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_reals); ++i) {
-        tag.floatValues[i] = parseReal(&token);
-      }
+    if (ts.num_strings < 0) {
+      ts.num_strings = 0;
+    }
+    if (ts.num_strings > max_tag_nums) {
+      ts.num_strings = max_tag_nums;
+    }
 
-      tag.stringValues.resize(static_cast<size_t>(ts.num_strings));
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_strings); ++i) {
-        tag.stringValues[i] = parseString(&token);
-      }
+    tag.intValues.resize(static_cast<size_t>(ts.num_ints));
 
-      tags.push_back(tag);
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_ints); ++i) {
+      tag.intValues[i] = parseInt(&token);
+    }
 
-      continue;
+    tag.floatValues.resize(static_cast<size_t>(ts.num_reals));
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_reals); ++i) {
+      tag.floatValues[i] = parseReal(&token);
     }
 
-    if (token[0] == 's' && IS_SPACE(token[1])) {
-      // smoothing group id
-      token += 2;
+    tag.stringValues.resize(static_cast<size_t>(ts.num_strings));
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_strings); ++i) {
+      tag.stringValues[i] = parseString(&token);
+    }
 
-      // skip space.
-      token += strspn(token, " \t");  // skip space
+    tags.push_back(tag);
 
-      if (token[0] == '\0') {
-        continue;
-      }
+    return true;
+  }
 
-      if (token[0] == '\r' || token[1] == '\n') {
-        continue;
-      }
+  if (token[0] == 's' && IS_SPACE(token[1])) {
+    // smoothing group id
+    token += 2;
+
+    // skip space.
+    token += strspn(token, " \t");  // skip space
+
+    if (token[0] == '\0') {
+      return true;
+    }
+
+    if (token[0] == '\r' || token[1] == '\n') {
+      return true;
+    }
 
-      if (strlen(token) >= 3 && token[0] == 'o' && token[1] == 'f' &&
-          token[2] == 'f') {
+    if (strlen(token) >= 3 && token[0] == 'o' && token[1] == 'f' &&
+        token[2] == 'f') {
+      current_smoothing_id = 0;
+    } else {
+      // assume number
+      int smGroupId = parseInt(&token);
+      if (smGroupId < 0) {
+        // parse error. force set to 0.
+        // FIXME(syoyo): Report warning.
         current_smoothing_id = 0;
       } else {
-        // assume number
-        int smGroupId = parseInt(&token);
-        if (smGroupId < 0) {
-          // parse error. force set to 0.
-          // FIXME(syoyo): Report warning.
-          current_smoothing_id = 0;
-        } else {
-          current_smoothing_id = static_cast<unsigned int>(smGroupId);
-        }
+        current_smoothing_id = static_cast<unsigned int>(smGroupId);
       }
+    }
 
-      continue;
-    }  // smoothing group id
+    return true;
+  }  // smoothing group id
 
-    // Ignore unknown command.
-  }
+  // Ignore unknown command.
+
+  return true;
+}
+
+// Flushes the pending groups and moves the parsed attributes into `attrib`.
+static bool FinishObj(ObjParseState &state, attrib_t *attrib,
+                      std::vector<shape_t> *shapes, std::string *warn,
+                      std::string *err, bool triangulate,
+                      bool default_vcols_fallback) {
+  std::stringstream errss;
+
+  std::vector<real_t> &v = state.v;
+  std::vector<real_t> &vn = state.vn;
+  std::vector<real_t> &vt = state.vt;
+  std::vector<real_t> &vc = state.vc;
+  std::vector<skin_weight_t> &vw = state.vw;
+  std::vector<tag_t> &tags = state.tags;
+  PrimGroup &prim_group = state.prim_group;
+  std::string &name = state.name;
+  int &material = state.material;
+  int &greatest_v_idx = state.greatest_v_idx;
+  int &greatest_vn_idx = state.greatest_vn_idx;
+  int &greatest_vt_idx = state.greatest_vt_idx;
+  shape_t &shape = state.shape;
+  bool &found_all_colors = state.found_all_colors;
+  const size_t line_num = state.line_num;
 
   // not all vertices have colors, no default colors desired? -> clear colors
   if (!found_all_colors && !default_vcols_fallback) {
@@ -3115,6 +3303,486 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
   return true;
 }
 
+bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+             std::vector<material_t> *materials, std::string *warn,
+             std::string *err, std::istream *inStream,
+             MaterialReader *readMatFn /*= NULL*/, bool triangulate,
+             bool default_vcols_fallback) {
+  ObjParseState state;
+
+  std::string linebuf;
+  while (inStream->peek() != -1) {
+    safeGetline(*inStream, linebuf);
+
+    state.line_num++;
+
+    // Trim newline '\r\n' or '\n'
+    if (linebuf.size() > 0) {
+      if (linebuf[linebuf.size() - 1] == '\n')
+        linebuf.erase(linebuf.size() - 1);
+    }
+    if (linebuf.size() > 0) {
+      if (linebuf[linebuf.size() - 1] == '\r')
+        linebuf.erase(linebuf.size() - 1);
+    }
+
+    // Skip if empty line.
+    if (linebuf.empty()) {
+      continue;
+    }
+
+    // Skip leading space.
+    const char *token = linebuf.c_str();
+    token += strspn(token, " \t");
+
+    assert(token);
+    if (token[0] == '\0') continue;  // empty line
+
+    if (token[0] == '#') continue;  // comment line
+
+    if (!ParseObjLine(state, token, shapes, materials, warn, err, readMatFn,
+                      triangulate, default_vcols_fallback)) {
+      return false;
+    }
+  }
+
+  return FinishObj(state, attrib, shapes, warn, err, triangulate,
+                   default_vcols_fallback);
+}
+
+// Face corner as written in the file. Relative indices are only fixed up
+// during the serial merge, once the number of preceding v/vn/vt is known.
+struct raw_corner_t {
+  int v_idx, vt_idx, vn_idx;
+  bool has_vt, has_vn;
+};
+
+// One run of consecutive lines of the same kind inside a chunk.
+struct obj_chunk_command_t {
+  enum kind_t { kVertex, kNormal, kTexcoord, kFace, kOther };
+
+  kind_t kind;
+  size_t line_num;  // line of the command, relative to the chunk
+  size_t first;     // first element (or byte offset of the line for kOther)
+  size_t count;     // number of elements (or line length for kOther)
+};
+
+// Output of the tokenizing pass over a range of whole lines.
+struct obj_chunk_t {
+  const char *begin;
+  const char *end;
+  size_t line_count;
+
+  std::vector<real_t> v;
+  std::vector<real_t> vc;
+  std::vector<char> v_has_color;
+  std::vector<real_t> vn;
+  std::vector<real_t> vt;
+  std::vector<raw_corner_t> corners;
+  std::vector<obj_chunk_command_t> commands;
+
+  obj_chunk_t() : begin(NULL), end(NULL), line_count(0) {}
+};
+
+// Same grammar as parseTriple, without fixing the indices.
+static raw_corner_t parseRawCorner(const char **token) {
+  raw_corner_t corner;
+  corner.v_idx = atoi((*token));
+  corner.vt_idx = corner.vn_idx = 0;
+  corner.has_vt = corner.has_vn = false;
+
+  (*token) += strcspn((*token), "/ \t\r");
+  if ((*token)[0] != '/') {
+    return corner;
+  }
+  (*token)++;
+
+  // i//k
+  if ((*token)[0] == '/') {
+    (*token)++;
+    corner.vn_idx = atoi((*token));
+    corner.has_vn = true;
+    (*token) += strcspn((*token), "/ \t\r");
+    return corner;
+  }
+
+  // i/j/k or i/j
+  corner.vt_idx = atoi((*token));
+  corner.has_vt = true;
+  (*token) += strcspn((*token), "/ \t\r");
+  if ((*token)[0] != '/') {
+    return corner;
+  }
+
+  // i/j/k
+  (*token)++;  // skip '/'
+  corner.vn_idx = atoi((*token));
+  corner.has_vn = true;
+  (*token) += strcspn((*token), "/ \t\r");
+  return corner;
+}
+
+static void pushChunkCommand(obj_chunk_t *chunk,
+                             obj_chunk_command_t::kind_t kind,
+                             size_t line_num, size_t first, size_t count) {
+  if (!chunk->commands.empty() && kind != obj_chunk_command_t::kFace &&
+      kind != obj_chunk_command_t::kOther) {
+    obj_chunk_command_t &last = chunk->commands.back();
+    if (last.kind == kind) {
+      last.count += count;
+      return;
+    }
+  }
+  obj_chunk_command_t command;
+  command.kind = kind;
+  command.line_num = line_num;
+  command.first = first;
+  command.count = count;
+  chunk->commands.push_back(command);
+}
+
+// Tokenizes `v`, `vn`, `vt` and `f` lines. Every other line is recorded as is
+// and parsed by ParseObjLine during the merge.
+static void ParseObjChunk(obj_chunk_t *chunk, const char *buf) {
+  std::string linebuf;
+  const char *p = chunk->begin;
+  while (p < chunk->end) {
+    // Line endings follow safeGetline: '\n', '\r\n' or '\r'
+    const char *line_end = p;
+    while (line_end < chunk->end && *line_end != '\n' && *line_end != '\r') {
+      line_end++;
+    }
+    const char *line_begin = p;
+    p = line_end;
+    if (p < chunk->end) {
+      if (*p == '\r' && p + 1 < chunk->end && p[1] == '\n') p++;
+      p++;
+    }
+
+    chunk->line_count++;
+    size_t line_num = chunk->line_count;
+
+    if (line_end == line_begin) continue;
+
+    linebuf.assign(line_begin, line_end);
+    const char *token = linebuf.c_str();
+    token += strspn(token, " \t");
+
+    if (token[0] == '\0') continue;  // empty line
+
+    if (token[0] == '#') continue;  // comment line
+
+    // vertex
+    if (token[0] == 'v' && IS_SPACE((token[1]))) {
+      token += 2;
+      real_t x, y, z;
+      real_t r, g, b;
+
+      bool found_color = parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+
+      pushChunkCommand(chunk, obj_chunk_command_t::kVertex, line_num,
+                       chunk->v_has_color.size(), 1);
+      chunk->v.push_back(x);
+      chunk->v.push_back(y);
+      chunk->v.push_back(z);
+      chunk->vc.push_back(r);
+      chunk->vc.push_back(g);
+      chunk->vc.push_back(b);
+      chunk->v_has_color.push_back(found_color);
+      continue;
+    }
+
+    // normal
+    if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y, z;
+      parseReal3(&x, &y, &z, &token);
+      pushChunkCommand(chunk, obj_chunk_command_t::kNormal, line_num,
+                       chunk->vn.size() / 3, 1);
+      chunk->vn.push_back(x);
+      chunk->vn.push_back(y);
+      chunk->vn.push_back(z);
+      continue;
+    }
+
+    // texcoord
+    if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y;
+      parseReal2(&x, &y, &token);
+      pushChunkCommand(chunk, obj_chunk_command_t::kTexcoord, line_num,
+                       chunk->vt.size() / 2, 1);
+      chunk->vt.push_back(x);
+      chunk->vt.push_back(y);
+      continue;
+    }
+
+    // face
+    if (token[0] == 'f' && IS_SPACE((token[1]))) {
+      token += 2;
+      token += strspn(token, " \t");
+
+      size_t first = chunk->corners.size();
+      while (!IS_NEW_LINE(token[0])) {
+        chunk->corners.push_back(parseRawCorner(&token));
+        size_t n = strspn(token, " \t\r");
+        token += n;
+      }
+      pushChunkCommand(chunk, obj_chunk_command_t::kFace, line_num, first,
+                       chunk->corners.size() - first);
+      continue;
+    }
+
+    pushChunkCommand(chunk, obj_chunk_command_t::kOther, line_num,
+                     size_t(line_begin - buf), size_t(line_end - line_begin));
+  }
+}
+
+// Splits [begin, end) at '\n' boundaries, which always end a line, and
+// tokenizes the pieces on up to `num_threads` threads (0 = hardware
+// concurrency).
+static void ParseObjChunks(std::vector<obj_chunk_t> *chunks, const char *buf,
+                           const char *begin, const char *end,
+                           unsigned int num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  // Small files are not worth the thread startup
+  const size_t min_chunk_size = 256 * 1024;
+  size_t len = size_t(end - begin);
+  size_t max_chunks = len / min_chunk_size;
+  size_t num_chunks = num_threads < max_chunks ? num_threads : max_chunks;
+  if (num_chunks == 0) num_chunks = 1;
+
+  chunks->assign(num_chunks, obj_chunk_t());
+  const char *chunk_begin = begin;
+  for (size_t i = 0; i < num_chunks; i++) {
+    const char *chunk_end = end;
+    if (i + 1 < num_chunks) {
+      chunk_end = begin + len * (i + 1) / num_chunks;
+      if (chunk_end < chunk_begin) chunk_end = chunk_begin;
+      while (chunk_end < end && *chunk_end != '\n') chunk_end++;
+      if (chunk_end < end) chunk_end++;
+    }
+    (*chunks)[i].begin = chunk_begin;
+    (*chunks)[i].end = chunk_end;
+    chunk_begin = chunk_end;
+  }
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < num_chunks; i++) {
+    workers.push_back(std::thread(ParseObjChunk, &(*chunks)[i], buf));
+  }
+  ParseObjChunk(&(*chunks)[0], buf);
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+}
+
+// Merges one tokenized chunk into `state`, going through the same state as
+// LoadObj. `line_base` is the number of lines before the chunk.
+static bool MergeObjChunk(ObjParseState &state, const obj_chunk_t &chunk,
+                          const char *buf, size_t line_base,
+                          std::vector<shape_t> *shapes,
+                          std::vector<material_t> *materials,
+                          std::string *warn, std::string *err,
+                          MaterialReader *readMatFn, bool triangulate,
+                          bool default_vcols_fallback) {
+  std::string linebuf;
+  for (size_t i = 0; i < chunk.commands.size(); i++) {
+    const obj_chunk_command_t &command = chunk.commands[i];
+    state.line_num = line_base + command.line_num;
+
+    switch (command.kind) {
+      case obj_chunk_command_t::kVertex:
+        for (size_t k = command.first; k < command.first + command.count;
+             k++) {
+          state.found_all_colors &= chunk.v_has_color[k] != 0;
+          state.v.insert(state.v.end(), chunk.v.begin() + 3 * k,
+                         chunk.v.begin() + 3 * k + 3);
+          if (state.found_all_colors || default_vcols_fallback) {
+            state.vc.insert(state.vc.end(), chunk.vc.begin() + 3 * k,
+                            chunk.vc.begin() + 3 * k + 3);
+          }
+        }
+        break;
+
+      case obj_chunk_command_t::kNormal:
+        state.vn.insert(state.vn.end(), chunk.vn.begin() + 3 * command.first,
+                        chunk.vn.begin() + 3 * (command.first + command.count));
+        break;
+
+      case obj_chunk_command_t::kTexcoord:
+        state.vt.insert(state.vt.end(), chunk.vt.begin() + 2 * command.first,
+                        chunk.vt.begin() + 2 * (command.first + command.count));
+        break;
+
+      case obj_chunk_command_t::kFace: {
+        warning_context context;
+        context.warn = warn;
+        context.line_number = state.line_num;
+
+        face_t face;
+        face.smoothing_group_id = state.current_smoothing_id;
+        face.vertex_indices.reserve(3);
+
+        int vsize = static_cast<int>(state.v.size() / 3);
+        int vnsize = static_cast<int>(state.vn.size() / 3);
+        int vtsize = static_cast<int>(state.vt.size() / 2);
+        for (size_t k = command.first; k < command.first + command.count;
+             k++) {
+          const raw_corner_t &corner = chunk.corners[k];
+          vertex_index_t vi(-1);
+          bool ok = fixIndex(corner.v_idx, vsize, &vi.v_idx, false, context);
+          if (ok && corner.has_vt) {
+            ok = fixIndex(corner.vt_idx, vtsize, &vi.vt_idx, true, context);
+          }
+          if (ok && corner.has_vn) {
+            ok = fixIndex(corner.vn_idx, vnsize, &vi.vn_idx, true, context);
+          }
+          if (!ok) {
+            if (err) {
+              (*err) += "Failed to parse `f' line (e.g. a zero value for vertex index or invalid relative vertex index). Line " +
+                  toString(state.line_num) + ").\n";
+            }
+            return false;
+          }
+
+          state.greatest_v_idx = state.greatest_v_idx > vi.v_idx ? state.greatest_v_idx : vi.v_idx;
+          state.greatest_vn_idx =
+              state.greatest_vn_idx > vi.vn_idx ? state.greatest_vn_idx : vi.vn_idx;
+          state.greatest_vt_idx =
+              state.greatest_vt_idx > vi.vt_idx ? state.greatest_vt_idx : vi.vt_idx;
+
+          face.vertex_indices.push_back(vi);
+        }
+
+        state.prim_group.faceGroup.push_back(face);
+        break;
+      }
+
+      case obj_chunk_command_t::kOther: {
+        linebuf.assign(buf + command.first, command.count);
+        const char *token = linebuf.c_str();
+        token += strspn(token, " \t");
+        if (!ParseObjLine(state, token, shapes, materials, warn, err,
+                          readMatFn, triangulate, default_vcols_fallback)) {
+          return false;
+        }
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+bool LoadObjParallel(attrib_t *attrib, std::vector<shape_t> *shapes,
+                     std::vector<material_t> *materials, std::string *warn,
+                     std::string *err, const char *buf, size_t len,
+                     MaterialReader *readMatFn /*= NULL*/, bool triangulate,
+                     bool default_vcols_fallback, unsigned int num_threads) {
+  std::vector<obj_chunk_t> chunks;
+  ParseObjChunks(&chunks, buf, buf, buf + len, num_threads);
+
+  // Merge the chunks in file order
+  ObjParseState state;
+  size_t line_base = 0;
+  for (size_t c = 0; c < chunks.size(); c++) {
+    if (!MergeObjChunk(state, chunks[c], buf, line_base, shapes, materials,
+                       warn, err, readMatFn, triangulate,
+                       default_vcols_fallback)) {
+      return false;
+    }
+    line_base += chunks[c].line_count;
+    // Merged: release the chunk so that its copy and the merged state never
+    // coexist for the whole file
+    chunks[c] = obj_chunk_t();
+  }
+  state.line_num = line_base;
+
+  return FinishObj(state, attrib, shapes, warn, err, triangulate,
+                   default_vcols_fallback);
+}
+
+// Hands the faces exported so far over to `callback.shape_cb`, with the
+// attributes read so far lent through `attrib`.
+static void StreamObjShapes(ObjParseState &state, attrib_t *attrib,
+                            std::vector<shape_t> *shapes,
+                            const stream_callback_t &callback,
+                            void *user_data) {
+  attrib->vertices.swap(state.v);
+  attrib->normals.swap(state.vn);
+  attrib->texcoords.swap(state.vt);
+  for (size_t i = 0; i < shapes->size(); i++) {
+    callback.shape_cb(user_data, *attrib, &(*shapes)[i]);
+  }
+  shapes->clear();
+  if (!state.shape.mesh.indices.empty()) {
+    callback.shape_cb(user_data, *attrib, &state.shape);
+  }
+  // The name stays: the next faces of the same group continue this shape
+  state.shape.mesh = mesh_t();
+  state.shape.lines = lines_t();
+  state.shape.points = points_t();
+  attrib->vertices.swap(state.v);
+  attrib->normals.swap(state.vn);
+  attrib->texcoords.swap(state.vt);
+}
+
+bool LoadObjStreamed(attrib_t *attrib, std::vector<material_t> *materials,
+                     const stream_callback_t &callback, void *user_data,
+                     std::string *warn, std::string *err, const char *buf,
+                     size_t len, MaterialReader *readMatFn /*= NULL*/,
+                     bool triangulate, bool default_vcols_fallback,
+                     unsigned int num_threads, size_t window_size) {
+  ObjParseState state;
+  std::vector<shape_t> shapes;
+  std::vector<obj_chunk_t> chunks;
+  size_t line_base = 0;
+  const char *buf_end = buf + len;
+  const char *window_begin = buf;
+  while (window_begin < buf_end) {
+    const char *window_end = buf_end;
+    if (size_t(buf_end - window_begin) > window_size) {
+      window_end = window_begin + window_size;
+      while (window_end < buf_end && *window_end != '\n') window_end++;
+      if (window_end < buf_end) window_end++;
+    }
+
+    ParseObjChunks(&chunks, buf, window_begin, window_end, num_threads);
+    for (size_t c = 0; c < chunks.size(); c++) {
+      if (!MergeObjChunk(state, chunks[c], buf, line_base, &shapes, materials,
+                         warn, err, readMatFn, triangulate,
+                         default_vcols_fallback)) {
+        return false;
+      }
+      line_base += chunks[c].line_count;
+      chunks[c] = obj_chunk_t();
+    }
+
+    // Faces are exported like `usemtl` does, the shape itself stays open
+    exportGroupsToShape(&state.shape, state.prim_group, state.tags,
+                        state.material, state.name, triangulate, state.v,
+                        warn);
+    state.prim_group.clear();
+    StreamObjShapes(state, attrib, &shapes, callback, user_data);
+    if (callback.consumed_cb) {
+      callback.consumed_cb(user_data, size_t(window_end - buf));
+    }
+    window_begin = window_end;
+  }
+  state.line_num = line_base;
+
+  if (!FinishObj(state, attrib, &shapes, warn, err, triangulate,
+                 default_vcols_fallback)) {
+    return false;
+  }
+  for (size_t i = 0; i < shapes.size(); i++) {
+    callback.shape_cb(user_data, *attrib, &shapes[i]);
+  }
+  return true;
+}
+
 bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
                          void *user_data /*= NULL*/,
                          MaterialReader *readMatFn /*= NULL*/,